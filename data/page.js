@@ -0,0 +1,40 @@
+// Shared by the pages: the markup is static and cached, and the values come
+// from the JSON API. Elements name the value they show with data-t (text),
+// data-class (an extra class), data-show (hidden while the value is empty)
+// and data-width (a width in percent). Only elements whose value changed
+// are touched, so a refresh does not relayout the whole page.
+function getJson(url) {
+  return fetch(url).then(response => response.json());
+}
+
+function poll(url, render, interval) {
+  const run = () => getJson(url).then(render).catch(() => {});
+  run();
+  setInterval(run, interval);
+}
+
+// Names missing from values are left as they are, so several endpoints can
+// fill different parts of one page
+function applyValues(values) {
+  document.querySelectorAll('[data-t]').forEach(el => {
+    if (!(el.dataset.t in values)) return;
+    const text = String(values[el.dataset.t]);
+    if (el.textContent !== text) el.textContent = text;
+  });
+  document.querySelectorAll('[data-class]').forEach(el => {
+    if (!(el.dataset.class in values)) return;
+    const cls = values[el.dataset.class] || '';
+    if (el.dataset.applied === cls) return;
+    if (el.dataset.applied) el.classList.remove(el.dataset.applied);
+    if (cls) el.classList.add(cls);
+    el.dataset.applied = cls;
+  });
+  document.querySelectorAll('[data-show]').forEach(el => {
+    if (el.dataset.show in values) el.hidden = !values[el.dataset.show];
+  });
+  document.querySelectorAll('[data-width]').forEach(el => {
+    if (!(el.dataset.width in values)) return;
+    const width = values[el.dataset.width] + '%';
+    if (el.style.width !== width) el.style.width = width;
+  });
+}
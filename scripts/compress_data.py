@@ -0,0 +1,31 @@
+# Builds the LittleFS image from a gzipped copy of data/. Text assets are
+# stored as <name>.gz and served with Content-Encoding: gzip; anything else
+# is copied unchanged. mtime is fixed so an unchanged file compresses to the
+# same bytes on every build. The device uses the CRC-32 that gzip stores in
+# each .gz trailer as the page's ETag, so any content change revalidates.
+import gzip
+import os
+import shutil
+
+Import("env")
+
+COMPRESSED = (".html", ".js", ".css", ".json", ".svg")
+
+source = env.subst("$PROJECT_DATA_DIR")
+target = os.path.join(env.subst("$PROJECT_BUILD_DIR"), "data-gz")
+
+shutil.rmtree(target, ignore_errors=True)
+for root, _, files in os.walk(source):
+    out_dir = os.path.join(target, os.path.relpath(root, source))
+    os.makedirs(out_dir, exist_ok=True)
+    for name in files:
+        path = os.path.join(root, name)
+        if name.endswith(COMPRESSED):
+            with open(path, "rb") as f_in:
+                data = f_in.read()
+            with open(os.path.join(out_dir, name + ".gz"), "wb") as f_out:
+                f_out.write(gzip.compress(data, compresslevel=9, mtime=0))
+        else:
+            shutil.copy2(path, out_dir)
+
+env.Replace(PROJECT_DATA_DIR=target)
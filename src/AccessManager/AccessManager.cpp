@@ -1,5 +1,8 @@
 #include "AccessManager.h"
 #include "../globals.h"
+#include <LittleFS.h>
+#include <climits>
+#include <cstddef>
 #include <cstdio>
 #include <cstring>
 
@@ -26,100 +29,440 @@ static unsigned long parseIso8601ToUnix(const char* str) {
   return days * 86400UL + (unsigned long)hour * 3600UL + (unsigned long)min * 60UL + (unsigned long)sec;
 }
 
-AccessManager::AccessManager() {
+const uint16_t AccessManager::MAX_PINS;
+
+static const char PIN_LOG_PATH[] = "/pins.log";
+static const char PIN_LOG_TMP_PATH[] = "/pins.tmp";
+static const char PIN_LOG_STAGE_PATH[] = "/pins.stage";
+static const uint32_t PIN_LOG_MAGIC = 0x4C4E4950;  // "PINL"
+static const uint16_t PIN_LOG_COMPACT_SLACK = 64;
+
+enum PinLogOp : uint8_t {
+    PIN_LOG_PUT = 1,
+    PIN_LOG_DELETE = 2,
+    PIN_LOG_SEQ = 3     // last applied sync sequence number, stored in start
+};
+
+// On-flash log record; a torn write at power loss fails the CRC check
+#pragma pack(push, 1)
+struct PinLogRecord {
+    uint8_t op;
+    uint16_t id;
+    char code[ACCESS_PIN_MAX_CODE_LEN + 1];
+    uint32_t start;
+    uint32_t end;
+    uint32_t crc;
+};
+#pragma pack(pop)
+
+static uint32_t pinLogCrc32(const uint8_t* data, size_t length) {
+    uint32_t crc = 0xFFFFFFFF;
+    while (length--) {
+        crc ^= *data++;
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+static uint32_t recordCrc(const PinLogRecord& record) {
+    return pinLogCrc32((const uint8_t*)&record, offsetof(PinLogRecord, crc));
+}
+
+static void fillRecord(PinLogRecord& record, uint8_t op, const AccessPin& pin) {
+    memset(&record, 0, sizeof(record));
+    record.op = op;
+    record.id = pin.id;
+    memcpy(record.code, pin.code, sizeof(record.code));
+    record.start = pin.start;
+    record.end = pin.end;
+    record.crc = recordCrc(record);
+}
+
+// Reads start_unix/end_unix, or ISO 8601 start/end, from an access code object
+static bool parseAccessWindow(JsonObject obj, unsigned long& startUnix, unsigned long& endUnix) {
+    if (obj.containsKey("start_unix") && obj.containsKey("end_unix")) {
+        startUnix = obj["start_unix"].as<unsigned long>();
+        endUnix = obj["end_unix"].as<unsigned long>();
+        return true;
+    }
+    if (obj.containsKey("start") && obj.containsKey("end")) {
+        startUnix = parseIso8601ToUnix(obj["start"].as<const char*>());
+        endUnix = parseIso8601ToUnix(obj["end"].as<const char*>());
+        if (startUnix == 0 || endUnix == 0) {
+            DEBUG_PRINTLN("[AccessManager] Skipping access code - invalid ISO 8601 date");
+            return false;
+        }
+        return true;
+    }
+    DEBUG_PRINTLN("[AccessManager] Skipping access code - missing start/end");
+    return false;
+}
+
+// Reads one entry of a full or paged sync: either an object with pin, id and
+// a start/end window, or the compact [id, pin, start_unix, end_unix] tuple
+// used by backends speaking MessagePack. id is left untouched when absent.
+static bool parseAccessCode(JsonVariant entry, int& id, const char*& code, unsigned long& startUnix, unsigned long& endUnix) {
+    JsonArray tuple = entry.as<JsonArray>();
+    if (!tuple.isNull()) {
+        if (tuple.size() < 4) return false;
+        code = tuple[1].as<const char*>();
+        if (!code || strlen(code) == 0) return false;
+        id = tuple[0].as<int>();
+        startUnix = tuple[2].as<unsigned long>();
+        endUnix = tuple[3].as<unsigned long>();
+        return true;
+    }
+
+    JsonObject obj = entry.as<JsonObject>();
+    code = obj["pin"].as<const char*>();
+    if (!code || strlen(code) == 0) return false;
+    if (!parseAccessWindow(obj, startUnix, endUnix)) return false;
+    if (obj.containsKey("id")) id = obj["id"].as<int>();
+    return true;
+}
+
+AccessManager::AccessManager()
+    : pinCount(0), expirySchedule(false), activationSchedule(true),
+      activeCount(0), lastCleanupMicros(0), maxCleanupMicros(0),
+      syncSeq(0), stageNextPart(0), stageParts(0), stageRecords(0),
+      stageTruncated(false), logRecords(0), loadMillis(0) {
+    stageBatch[0] = '\0';
+    indexClear();
+}
+
+void AccessManager::begin() {
+    unsigned long startedAt = millis();
+    LittleFS.remove(PIN_LOG_STAGE_PATH);  // an interrupted paged sync is discarded
+    loadLog();
+    loadMillis = millis() - startedAt;
+    DEBUG_PRINT("[AccessManager] Loaded ");
+    DEBUG_PRINT(pinCount);
+    DEBUG_PRINT(" access codes in ");
+    DEBUG_PRINT(loadMillis);
+    DEBUG_PRINTLN(" ms");
+}
+
+// Rebuilds the in-memory table from the LittleFS log
+void AccessManager::loadLog() {
+    pinCount = 0;
+    indexClear();
+    scheduleClear();
+    logRecords = 0;
+
+    File file = LittleFS.open(PIN_LOG_PATH, "r");
+    if (!file) {
+        DEBUG_PRINTLN("[AccessManager] No persisted access codes");
+        return;
+    }
+
+    uint32_t magic = 0;
+    bool intact = file.read((uint8_t*)&magic, sizeof(magic)) == sizeof(magic) && magic == PIN_LOG_MAGIC;
+
+    PinLogRecord record;
+    while (intact && file.available()) {
+        if (file.read((uint8_t*)&record, sizeof(record)) != sizeof(record) || record.crc != recordCrc(record)) {
+            // Truncated or torn tail (power cut mid-write): keep what replayed so far
+            intact = false;
+            break;
+        }
+        record.code[sizeof(record.code) - 1] = '\0';
+        if (record.op == PIN_LOG_PUT) {
+            createPin(record.id, record.code, record.start, record.end);
+        } else if (record.op == PIN_LOG_DELETE) {
+            deletePin(record.id);
+        } else if (record.op == PIN_LOG_SEQ) {
+            syncSeq = record.start;
+        }
+        logRecords++;
+    }
+    file.close();
+
+    if (!intact) {
+        DEBUG_PRINTLN("[AccessManager] Access code log damaged, rewriting from recovered records");
+        compactLog();
+    }
 }
 
-void AccessManager::handlePinAction(String action, int id, String code, unsigned long start, unsigned long end) {
+bool AccessManager::handlePinAction(String action, int id, String code, unsigned long start, unsigned long end) {
     DEBUG_PRINT("[AccessManager] Handling action: ");
     DEBUG_PRINT(action);
     DEBUG_PRINT(" for ID: ");
     DEBUG_PRINTLN(id);
 
     if (action == "create") {
-        createPin(id, code, start, end);
+        if (!createPin(id, code.c_str(), start, end)) return false;
+        logPut(findById(id));
+        return true;
     } else if (action == "update") {
-        updatePin(id, code, start, end);
+        updatePin(id, code.c_str(), start, end);
+        uint16_t pos = findById(id);
+        if (pos == NOT_FOUND) return false;
+        logPut(pos);
+        return true;
     } else if (action == "delete") {
         deletePin(id);
-    } else {
-        DEBUG_PRINTLN("[AccessManager] Unknown action");
+        logDelete(id);
+        return true;
     }
+
+    DEBUG_PRINTLN("[AccessManager] Unknown action");
+    return false;
 }
 
-void AccessManager::createPin(int id, String code, unsigned long start, unsigned long end) {
-    // Check if already exists, if so, update
-    for (auto& pin : pins) {
-        if (pin.id == id) {
-            DEBUG_PRINTLN("[AccessManager] Pin ID already exists, updating instead.");
-            pin.code = code;
-            pin.start = start;
-            pin.end = end;
-            return;
+AccessManager::DeltaResult AccessManager::applyDelta(JsonObject data) {
+    uint32_t seq = data["seq"] | 0UL;
+    const char* op = data["op"].as<const char*>();
+    if (seq == 0 || !op || !data.containsKey("id")) {
+        DEBUG_PRINTLN("[AccessManager] Delta missing seq/op/id");
+        return DELTA_INVALID;
+    }
+
+    if (seq <= syncSeq) {
+        DEBUG_PRINTLN("[AccessManager] Delta already applied, ignoring");
+        return DELTA_DUPLICATE;
+    }
+    if (seq != syncSeq + 1) {
+        DEBUG_PRINT("[AccessManager] Delta sequence gap, expected ");
+        DEBUG_PRINTLN(syncSeq + 1);
+        return DELTA_GAP;
+    }
+
+    int id = data["id"].as<int>();
+    const char* code = data["pin"] | "";
+    unsigned long startUnix = 0;
+    unsigned long endUnix = 0;
+    if (strcmp(op, "delete") != 0) {
+        if (strlen(code) == 0 || !parseAccessWindow(data, startUnix, endUnix)) {
+            return DELTA_INVALID;
         }
     }
-    
-    AccessPin newPin = {id, code, start, end};
-    pins.push_back(newPin);
+
+    // createPin upserts, so "update" of an unknown id is treated as a create
+    String action = (strcmp(op, "update") == 0 && findById(id) == NOT_FOUND) ? String("create") : String(op);
+    if (!handlePinAction(action, id, String(code), startUnix, endUnix)) {
+        return isFull() ? DELTA_TABLE_FULL : DELTA_INVALID;
+    }
+
+    syncSeq = seq;
+    logSeq();
+    return DELTA_APPLIED;
+}
+
+bool AccessManager::createPin(int id, const char* code, unsigned long start, unsigned long end) {
+    if (strlen(code) > ACCESS_PIN_MAX_CODE_LEN) {
+        DEBUG_PRINTLN("[AccessManager] Pin code too long, ignoring create.");
+        return false;
+    }
+
+    // Check if already exists, if so, update
+    if (findById(id) != NOT_FOUND) {
+        DEBUG_PRINTLN("[AccessManager] Pin ID already exists, updating instead.");
+        updatePin(id, code, start, end);
+        return true;
+    }
+
+    if (isFull()) {
+        DEBUG_PRINTLN("[AccessManager] Pin table full, ignoring create.");
+        return false;
+    }
+
+    uint16_t pos = pinCount++;
+    AccessPin& pin = pins[pos];
+    strncpy(pin.code, code, sizeof(pin.code));
+    pin.code[sizeof(pin.code) - 1] = '\0';
+    pin.start = start;
+    pin.end = end;
+    pin.id = (uint16_t)id;
+    indexInsert(codeIndex, pos);
+    indexInsert(idIndex, pos);
+    scheduleInsert(pos);
     DEBUG_PRINTLN("[AccessManager] Pin created.");
+    return true;
 }
 
-void AccessManager::updatePin(int id, String code, unsigned long start, unsigned long end) {
-    for (auto& pin : pins) {
-        if (pin.id == id) {
-            pin.code = code;
-            pin.start = start;
-            pin.end = end;
-            DEBUG_PRINTLN("[AccessManager] Pin updated.");
-            return;
-        }
+void AccessManager::updatePin(int id, const char* code, unsigned long start, unsigned long end) {
+    if (strlen(code) > ACCESS_PIN_MAX_CODE_LEN) {
+        DEBUG_PRINTLN("[AccessManager] Pin code too long, ignoring update.");
+        return;
     }
-    DEBUG_PRINTLN("[AccessManager] Pin ID not found for update.");
+
+    uint16_t pos = findById(id);
+    if (pos == NOT_FOUND) {
+        DEBUG_PRINTLN("[AccessManager] Pin ID not found for update.");
+        return;
+    }
+
+    AccessPin& pin = pins[pos];
+    if (strcmp(pin.code, code) != 0) {
+        indexRemove(codeIndex, pos);
+        strncpy(pin.code, code, sizeof(pin.code));
+        pin.code[sizeof(pin.code) - 1] = '\0';
+        indexInsert(codeIndex, pos);
+    }
+    pin.start = start;
+    pin.end = end;
+    scheduleUpdate(pos);
+    DEBUG_PRINTLN("[AccessManager] Pin updated.");
 }
 
 void AccessManager::deletePin(int id) {
-    for (auto it = pins.begin(); it != pins.end(); ++it) {
-        if (it->id == id) {
-            pins.erase(it);
-            DEBUG_PRINTLN("[AccessManager] Pin deleted.");
-            return;
-        }
+    uint16_t pos = findById(id);
+    if (pos == NOT_FOUND) {
+        DEBUG_PRINTLN("[AccessManager] Pin ID not found for deletion.");
+        return;
+    }
+    removeAt(pos);
+    DEBUG_PRINTLN("[AccessManager] Pin deleted.");
+}
+
+uint16_t AccessManager::findById(int id) const {
+    for (uint16_t slot = hashId((uint16_t)id) & INDEX_MASK; idIndex[slot] != INDEX_EMPTY; slot = (slot + 1) & INDEX_MASK) {
+        if (pins[idIndex[slot]].id == (uint16_t)id) return idIndex[slot];
+    }
+    return NOT_FOUND;
+}
+
+// Swap-and-pop removal: order of pins is irrelevant, and moving only the last
+// entry keeps the hash index updates O(1) instead of shifting every position.
+void AccessManager::removeAt(uint16_t pos) {
+    uint16_t last = pinCount - 1;
+    indexRemove(codeIndex, pos);
+    indexRemove(idIndex, pos);
+    expirySchedule.remove(pins, pos);
+    if (activationSchedule.contains(pos)) {
+        activationSchedule.remove(pins, pos);
+    }
+    if (pins[pos].active) {
+        activeCount--;
     }
-    DEBUG_PRINTLN("[AccessManager] Pin ID not found for deletion.");
+    if (pos != last) {
+        indexReplace(codeIndex, last, pos);
+        indexReplace(idIndex, last, pos);
+        expirySchedule.relocate(last, pos);
+        activationSchedule.relocate(last, pos);
+        pins[pos] = pins[last];
+    }
+    pinCount--;
 }
 
-void AccessManager::syncFromBackend(JsonArray accessCodes) {
-    pins.clear();
+bool AccessManager::syncFromBackend(JsonArray accessCodes, uint32_t seq) {
+    pinCount = 0;
+    indexClear();
+    scheduleClear();
+    syncSeq = seq;
     int id = 0;
+    bool complete = true;
     for (JsonVariant v : accessCodes) {
-        JsonObject obj = v.as<JsonObject>();
-        const char* code = obj["pin"].as<const char*>();
-        if (!code || strlen(code) == 0) continue;
-
+        // Backends that send deltas also send stable ids; older ones rely on position
+        int pinId = id;
+        const char* code;
         unsigned long startUnix;
         unsigned long endUnix;
+        if (!parseAccessCode(v, pinId, code, startUnix, endUnix)) continue;
 
-        if (obj.containsKey("start_unix") && obj.containsKey("end_unix")) {
-            startUnix = obj["start_unix"].as<unsigned long>();
-            endUnix = obj["end_unix"].as<unsigned long>();
-        } else if (obj.containsKey("start") && obj.containsKey("end")) {
-            const char* startStr = obj["start"].as<const char*>();
-            const char* endStr = obj["end"].as<const char*>();
-            startUnix = parseIso8601ToUnix(startStr);
-            endUnix = parseIso8601ToUnix(endStr);
-            if (startUnix == 0 || endUnix == 0) {
-                DEBUG_PRINTLN("[AccessManager] Skipping access code - invalid ISO 8601 date");
-                continue;
-            }
-        } else {
-            DEBUG_PRINTLN("[AccessManager] Skipping access code - missing start/end");
-            continue;
+        if (isFull()) {
+            DEBUG_PRINTLN("[AccessManager] Pin table full, dropping remaining access codes");
+            complete = false;
+            break;
         }
-
-        createPin(id++, String(code), startUnix, endUnix);
+        id++;
+        createPin(pinId, code, startUnix, endUnix);
     }
     DEBUG_PRINT("[AccessManager] Synced ");
-    DEBUG_PRINT(pins.size());
+    DEBUG_PRINT(pinCount);
     DEBUG_PRINTLN(" access codes from backend.");
+    compactLog();
+    return complete;
+}
+
+// Paged full sync: each page is appended to a staging snapshot on LittleFS
+// instead of RAM, and the staging file replaces the log (and the live table)
+// only once the last page has arrived.
+AccessManager::StageResult AccessManager::stageSyncPage(const char* batchId, uint16_t part, uint16_t parts, uint32_t seq, JsonArray accessCodes) {
+    if (!batchId || parts == 0 || part == 0 || part > parts) {
+        return STAGE_FAILED;
+    }
+
+    // QoS 1 redelivers a page whose ack was lost; it is already staged
+    if (stageNextPart != 0 && part == stageNextPart - 1 && parts == stageParts && strcmp(batchId, stageBatch) == 0) {
+        DEBUG_PRINTLN("[AccessManager] Sync page already staged, ignoring redelivery");
+        return STAGE_DUPLICATE;
+    }
+
+    if (part == 1) {
+        strncpy(stageBatch, batchId, sizeof(stageBatch) - 1);
+        stageBatch[sizeof(stageBatch) - 1] = '\0';
+        stageParts = parts;
+        stageNextPart = 1;
+        stageRecords = 0;
+        stageTruncated = false;
+
+        File file = LittleFS.open(PIN_LOG_STAGE_PATH, "w");
+        if (!file) {
+            stageNextPart = 0;
+            return STAGE_FAILED;
+        }
+        PinLogRecord record;
+        AccessPin seqPin = {};
+        seqPin.start = seq;
+        fillRecord(record, PIN_LOG_SEQ, seqPin);
+        file.write((const uint8_t*)&PIN_LOG_MAGIC, sizeof(PIN_LOG_MAGIC));
+        file.write((const uint8_t*)&record, sizeof(record));
+        file.close();
+    }
+
+    if (stageNextPart == 0 || part != stageNextPart || parts != stageParts || strcmp(batchId, stageBatch) != 0) {
+        DEBUG_PRINTLN("[AccessManager] Sync page out of order, discarding batch");
+        stageNextPart = 0;
+        LittleFS.remove(PIN_LOG_STAGE_PATH);
+        return STAGE_OUT_OF_ORDER;
+    }
+
+    File file = LittleFS.open(PIN_LOG_STAGE_PATH, "a");
+    if (!file) {
+        stageNextPart = 0;
+        return STAGE_FAILED;
+    }
+
+    PinLogRecord record;
+    AccessPin pin = {};
+    for (JsonVariant v : accessCodes) {
+        int pinId = stageRecords;
+        const char* code;
+        unsigned long startUnix;
+        unsigned long endUnix;
+        if (!parseAccessCode(v, pinId, code, startUnix, endUnix)) continue;
+        if (strlen(code) > ACCESS_PIN_MAX_CODE_LEN) continue;
+
+        if (stageRecords >= MAX_PINS) {
+            stageTruncated = true;
+            break;
+        }
+        pin.id = (uint16_t)pinId;
+        strncpy(pin.code, code, sizeof(pin.code));
+        pin.code[sizeof(pin.code) - 1] = '\0';
+        pin.start = startUnix;
+        pin.end = endUnix;
+        fillRecord(record, PIN_LOG_PUT, pin);
+        file.write((const uint8_t*)&record, sizeof(record));
+        stageRecords++;
+    }
+    file.close();
+
+    if (part < parts) {
+        stageNextPart++;
+        return STAGE_PENDING;
+    }
+
+    stageNextPart = 0;
+    LittleFS.rename(PIN_LOG_STAGE_PATH, PIN_LOG_PATH);
+    loadLog();
+    DEBUG_PRINT("[AccessManager] Paged sync committed with ");
+    DEBUG_PRINT(pinCount);
+    DEBUG_PRINTLN(" access codes.");
+    return stageTruncated ? STAGE_COMMITTED_TRUNCATED : STAGE_COMMITTED;
 }
 
 bool AccessManager::validate(String inputCode) {
@@ -139,16 +482,18 @@ bool AccessManager::validate(String inputCode) {
          return false; 
     }
 
-    for (const auto& pin : pins) {
-        if (pin.code == inputCode) {
-            if (currentUnixTime >= pin.start && currentUnixTime <= pin.end) {
-                DEBUG_PRINT("[AccessManager] Validated Temp PIN ID: ");
-                DEBUG_PRINTLN(pin.id);
-                return true;
-            } else {
-                DEBUG_PRINT("[AccessManager] PIN found but time invalid. ID: ");
-                DEBUG_PRINTLN(pin.id);
-            }
+    const char* input = inputCode.c_str();
+    for (uint16_t slot = hashCode(input) & INDEX_MASK; codeIndex[slot] != INDEX_EMPTY; slot = (slot + 1) & INDEX_MASK) {
+        const AccessPin& pin = pins[codeIndex[slot]];
+        if (strcmp(pin.code, input) != 0) continue;
+
+        if (currentUnixTime >= pin.start && currentUnixTime <= pin.end) {
+            DEBUG_PRINT("[AccessManager] Validated Temp PIN ID: ");
+            DEBUG_PRINTLN(pin.id);
+            return true;
+        } else {
+            DEBUG_PRINT("[AccessManager] PIN found but time invalid. ID: ");
+            DEBUG_PRINTLN(pin.id);
         }
     }
 
@@ -159,15 +504,284 @@ bool AccessManager::validate(String inputCode) {
 void AccessManager::cleanup() {
     unsigned long currentUnixTime = systemClock.getUnixTime();
     if (currentUnixTime < 1000000) return; // Don't cleanup if time is wrong
+    if (currentUnixTime < getNextDeadline()) return;
 
-    auto it = pins.begin();
-    while (it != pins.end()) {
-        if (it->end < currentUnixTime) {
-            DEBUG_PRINT("[AccessManager] Removing expired PIN ID: ");
-            DEBUG_PRINTLN(it->id);
-            it = pins.erase(it);
-        } else {
-            ++it;
+    unsigned long startedAt = micros();
+
+    while (!expirySchedule.empty() && pins[expirySchedule.top()].end < currentUnixTime) {
+        uint16_t pos = expirySchedule.top();
+        uint16_t id = pins[pos].id;
+        DEBUG_PRINT("[AccessManager] Removing expired PIN ID: ");
+        DEBUG_PRINTLN(id);
+        removeAt(pos);
+        // Logged like any delete, so replay and compaction never carry it again
+        logDelete(id);
+    }
+
+    while (!activationSchedule.empty() && pins[activationSchedule.top()].start <= currentUnixTime) {
+        uint16_t pos = activationSchedule.top();
+        activationSchedule.remove(pins, pos);
+        pins[pos].active = true;
+        activeCount++;
+        DEBUG_PRINT("[AccessManager] PIN became active. ID: ");
+        DEBUG_PRINTLN(pins[pos].id);
+    }
+
+    lastCleanupMicros = micros() - startedAt;
+    if (lastCleanupMicros > maxCleanupMicros) {
+        maxCleanupMicros = lastCleanupMicros;
+    }
+}
+
+unsigned long AccessManager::getNextDeadline() const {
+    unsigned long next = ULONG_MAX;
+    if (!expirySchedule.empty()) {
+        // Pins expire once the clock moves past end (see validate)
+        unsigned long end = pins[expirySchedule.top()].end;
+        if (end < ULONG_MAX) next = end + 1;
+    }
+    if (!activationSchedule.empty()) {
+        unsigned long start = pins[activationSchedule.top()].start;
+        if (start < next) next = start;
+    }
+    return next;
+}
+
+void AccessManager::logPut(uint16_t pos) {
+    appendLog(PIN_LOG_PUT, pins[pos]);
+}
+
+void AccessManager::logDelete(int id) {
+    AccessPin pin = {};
+    pin.id = (uint16_t)id;
+    appendLog(PIN_LOG_DELETE, pin);
+}
+
+void AccessManager::logSeq() {
+    AccessPin pin = {};
+    pin.start = syncSeq;
+    appendLog(PIN_LOG_SEQ, pin);
+}
+
+void AccessManager::appendLog(uint8_t op, const AccessPin& pin) {
+    PinLogRecord record;
+    fillRecord(record, op, pin);
+
+    File file = LittleFS.open(PIN_LOG_PATH, "a");
+    if (!file) return;
+    if (file.size() == 0) {
+        file.write((const uint8_t*)&PIN_LOG_MAGIC, sizeof(PIN_LOG_MAGIC));
+    }
+    file.write((const uint8_t*)&record, sizeof(record));
+    file.close();
+
+    if (++logRecords > 2 * pinCount + PIN_LOG_COMPACT_SLACK) {
+        compactLog();
+    }
+}
+
+// Write the live table to a temp file and rename it over the log, so a
+// power cut leaves either the old log or the complete new snapshot.
+void AccessManager::compactLog() {
+    File file = LittleFS.open(PIN_LOG_TMP_PATH, "w");
+    if (!file) {
+        DEBUG_PRINTLN("[AccessManager] Failed to open access code snapshot");
+        return;
+    }
+
+    file.write((const uint8_t*)&PIN_LOG_MAGIC, sizeof(PIN_LOG_MAGIC));
+    PinLogRecord record;
+    AccessPin seqPin = {};
+    seqPin.start = syncSeq;
+    fillRecord(record, PIN_LOG_SEQ, seqPin);
+    file.write((const uint8_t*)&record, sizeof(record));
+    for (uint16_t i = 0; i < pinCount; i++) {
+        fillRecord(record, PIN_LOG_PUT, pins[i]);
+        file.write((const uint8_t*)&record, sizeof(record));
+    }
+    file.close();
+
+    LittleFS.rename(PIN_LOG_TMP_PATH, PIN_LOG_PATH);
+    logRecords = pinCount + 1;
+}
+
+void AccessManager::scheduleClear() {
+    expirySchedule.clear();
+    activationSchedule.clear();
+    activeCount = 0;
+}
+
+void AccessManager::scheduleInsert(uint16_t pos) {
+    pins[pos].active = false;
+    expirySchedule.push(pins, pos);
+    activationSchedule.push(pins, pos);
+}
+
+// Re-key a pin whose start/end changed. An already active pin goes back to
+// pending; the next due cleanup() re-activates it if its new start has passed.
+void AccessManager::scheduleUpdate(uint16_t pos) {
+    expirySchedule.update(pins, pos);
+    if (activationSchedule.contains(pos)) {
+        activationSchedule.update(pins, pos);
+        return;
+    }
+    if (pins[pos].active) {
+        pins[pos].active = false;
+        activeCount--;
+    }
+    activationSchedule.push(pins, pos);
+}
+
+// FNV-1a, 16-bit folded
+uint16_t AccessManager::hashCode(const char* code) {
+    uint32_t hash = 2166136261UL;
+    while (*code) {
+        hash ^= (uint8_t)*code++;
+        hash *= 16777619UL;
+    }
+    return (uint16_t)(hash ^ (hash >> 16));
+}
+
+// Fibonacci hashing spreads sequential backend ids across the table
+uint16_t AccessManager::hashId(uint16_t id) {
+    uint32_t hash = (uint32_t)id * 2654435769UL;
+    return (uint16_t)(hash ^ (hash >> 16));
+}
+
+uint16_t AccessManager::indexHome(const uint16_t* table, uint16_t pos) const {
+    uint16_t hash = (table == idIndex) ? hashId(pins[pos].id) : hashCode(pins[pos].code);
+    return hash & INDEX_MASK;
+}
+
+void AccessManager::indexClear() {
+    for (uint16_t i = 0; i < INDEX_SIZE; i++) {
+        codeIndex[i] = INDEX_EMPTY;
+        idIndex[i] = INDEX_EMPTY;
+    }
+}
+
+void AccessManager::indexInsert(uint16_t* table, uint16_t pos) {
+    uint16_t slot = indexHome(table, pos);
+    while (table[slot] != INDEX_EMPTY) {
+        slot = (slot + 1) & INDEX_MASK;
+    }
+    table[slot] = pos;
+}
+
+uint16_t AccessManager::indexFind(const uint16_t* table, uint16_t pos) const {
+    uint16_t slot = indexHome(table, pos);
+    while (table[slot] != INDEX_EMPTY) {
+        if (table[slot] == pos) return slot;
+        slot = (slot + 1) & INDEX_MASK;
+    }
+    return INDEX_EMPTY;
+}
+
+void AccessManager::indexReplace(uint16_t* table, uint16_t from, uint16_t to) {
+    uint16_t slot = indexFind(table, from);
+    if (slot != INDEX_EMPTY) {
+        table[slot] = to;
+    }
+}
+
+// Backward-shift deletion keeps probe chains intact without tombstones.
+void AccessManager::indexRemove(uint16_t* table, uint16_t pos) {
+    uint16_t hole = indexFind(table, pos);
+    if (hole == INDEX_EMPTY) return;
+
+    uint16_t next = hole;
+    while (true) {
+        next = (next + 1) & INDEX_MASK;
+        if (table[next] == INDEX_EMPTY) break;
+
+        uint16_t home = indexHome(table, table[next]);
+        // Move the entry back only if its home slot is not within (hole, next]
+        bool homeInRange = (hole <= next)
+            ? (home > hole && home <= next)
+            : (home > hole || home <= next);
+        if (!homeInRange) {
+            table[hole] = table[next];
+            hole = next;
+        }
+    }
+    table[hole] = INDEX_EMPTY;
+}
+
+PinSchedule::PinSchedule(bool byStart) : byStart(byStart) {
+    clear();
+}
+
+void PinSchedule::clear() {
+    size = 0;
+    for (uint16_t i = 0; i < ACCESS_MANAGER_MAX_PINS; i++) {
+        slotOf[i] = NONE;
+    }
+}
+
+void PinSchedule::place(uint16_t slot, uint16_t pos) {
+    items[slot] = pos;
+    slotOf[pos] = slot;
+}
+
+void PinSchedule::push(const AccessPin* pins, uint16_t pos) {
+    place(size, pos);
+    siftUp(pins, size++);
+}
+
+void PinSchedule::remove(const AccessPin* pins, uint16_t pos) {
+    uint16_t slot = slotOf[pos];
+    if (slot == NONE) return;
+
+    slotOf[pos] = NONE;
+    size--;
+    if (slot == size) return;
+
+    uint16_t moved = items[size];
+    place(slot, moved);
+    siftUp(pins, slot);
+    siftDown(pins, slotOf[moved]);
+}
+
+void PinSchedule::update(const AccessPin* pins, uint16_t pos) {
+    uint16_t slot = slotOf[pos];
+    if (slot == NONE) return;
+    siftUp(pins, slot);
+    siftDown(pins, slotOf[pos]);
+}
+
+// The pin stored at position `from` moved to position `to` (swap-and-pop)
+void PinSchedule::relocate(uint16_t from, uint16_t to) {
+    uint16_t slot = slotOf[from];
+    slotOf[from] = NONE;
+    if (slot != NONE) {
+        place(slot, to);
+    }
+}
+
+void PinSchedule::siftUp(const AccessPin* pins, uint16_t slot) {
+    uint16_t pos = items[slot];
+    unsigned long key = keyOf(pins[pos]);
+    while (slot > 0) {
+        uint16_t parent = (slot - 1) / 2;
+        if (keyOf(pins[items[parent]]) <= key) break;
+        place(slot, items[parent]);
+        slot = parent;
+    }
+    place(slot, pos);
+}
+
+void PinSchedule::siftDown(const AccessPin* pins, uint16_t slot) {
+    uint16_t pos = items[slot];
+    unsigned long key = keyOf(pins[pos]);
+    while (true) {
+        uint32_t child = 2 * (uint32_t)slot + 1;
+        if (child >= size) break;
+        if (child + 1 < size && keyOf(pins[items[child + 1]]) < keyOf(pins[items[child]])) {
+            child++;
         }
+        if (key <= keyOf(pins[items[child]])) break;
+        place(slot, items[child]);
+        slot = child;
     }
+    place(slot, pos);
 }
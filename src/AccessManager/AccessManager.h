@@ -3,28 +3,174 @@
 
 #include <Arduino.h>
 #include <ArduinoJson.h>
-#include <vector>
 
+// Maximum number of temporary PINs kept in memory. The whole table is static
+// (about 38 bytes per code with its two indexes and schedules), so capacity comes
+// straight out of the heap that OTA (25 KB free, see Sync::updateFirmware)
+// and TLS need; 96 codes take 3.7 KB. Override with
+// -D ACCESS_MANAGER_MAX_PINS=<n> in platformio.ini build_flags.
+#ifndef ACCESS_MANAGER_MAX_PINS
+#define ACCESS_MANAGER_MAX_PINS 96
+#endif
+
+static_assert(ACCESS_MANAGER_MAX_PINS > 0 && ACCESS_MANAGER_MAX_PINS <= 16384,
+              "ACCESS_MANAGER_MAX_PINS must be between 1 and 16384");
+
+constexpr uint16_t accessIndexSizeFor(uint32_t n, uint32_t size = 1) {
+    return size >= n * 2 ? size : accessIndexSizeFor(n, size * 2);
+}
+
+// Longest temporary PIN accepted; codes are stored inline, NUL-terminated.
+static const size_t ACCESS_PIN_MAX_CODE_LEN = 7;
+
+// Fixed-width record kept in a preallocated pool (no heap allocation per code).
 struct AccessPin {
-    int id;
-    String code;
-    unsigned long start;
-    unsigned long end;
+    char code[ACCESS_PIN_MAX_CODE_LEN + 1];
+    uint32_t start;
+    uint32_t end;
+    uint16_t id;
+    bool active;
+};
+
+// Indexed binary min-heap of pin positions, keyed on either start or end.
+// slotOf[] maps a pin position back to its heap slot so updates and removals
+// of arbitrary pins stay O(log n).
+class PinSchedule {
+public:
+    static const uint16_t NONE = 0xFFFF;
+
+    explicit PinSchedule(bool byStart);
+    void clear();
+    bool empty() const { return size == 0; }
+    bool contains(uint16_t pos) const { return slotOf[pos] != NONE; }
+    uint16_t top() const { return items[0]; }
+    void push(const AccessPin* pins, uint16_t pos);
+    void remove(const AccessPin* pins, uint16_t pos);
+    void update(const AccessPin* pins, uint16_t pos);
+    void relocate(uint16_t from, uint16_t to);
+    unsigned long keyOf(const AccessPin& pin) const { return byStart ? pin.start : pin.end; }
+
+private:
+    bool byStart;
+    uint16_t size;
+    uint16_t items[ACCESS_MANAGER_MAX_PINS];
+    uint16_t slotOf[ACCESS_MANAGER_MAX_PINS];
+
+    void place(uint16_t slot, uint16_t pos);
+    void siftUp(const AccessPin* pins, uint16_t slot);
+    void siftDown(const AccessPin* pins, uint16_t slot);
 };
 
 class AccessManager {
 public:
+    static const uint16_t MAX_PINS = ACCESS_MANAGER_MAX_PINS;
+
+    enum DeltaResult {
+        DELTA_APPLIED,
+        DELTA_DUPLICATE,   // seq already applied (redelivery)
+        DELTA_GAP,         // a seq was missed; backend must resend a full sync
+        DELTA_INVALID,
+        DELTA_TABLE_FULL
+    };
+
     AccessManager();
-    void handlePinAction(String action, int id, String code, unsigned long start, unsigned long end);
-    void syncFromBackend(JsonArray accessCodes);
+    // Reload the persisted table from LittleFS (call once the filesystem is mounted)
+    void begin();
+    bool handlePinAction(String action, int id, String code, unsigned long start, unsigned long end);
+    // Replaces the whole table; seq is the backend sequence it corresponds to.
+    // Returns false when some codes were dropped because the table is full
+    bool syncFromBackend(JsonArray accessCodes, uint32_t seq);
+    // Applies a single create/update/delete carrying the next sequence number
+    DeltaResult applyDelta(JsonObject data);
+
+    enum StageResult {
+        STAGE_PENDING,               // page stored, waiting for the next one
+        STAGE_COMMITTED,             // last page arrived, table swapped in
+        STAGE_COMMITTED_TRUNCATED,   // swapped in, but codes beyond MAX_PINS were dropped
+        STAGE_DUPLICATE,             // redelivery of the page staged last, ignored
+        STAGE_OUT_OF_ORDER,          // wrong batch/part, staging discarded
+        STAGE_FAILED
+    };
+    // Multi-part full sync (part is 1-based); the table only changes on the last part
+    StageResult stageSyncPage(const char* batchId, uint16_t part, uint16_t parts, uint32_t seq, JsonArray accessCodes);
+    uint32_t getSyncSeq() const { return syncSeq; }
     bool validate(String inputCode);
     void cleanup();
 
+    // Unix time at which cleanup() next has work to do (an expiry or an
+    // activation); ULONG_MAX when nothing is scheduled.
+    unsigned long getNextDeadline() const;
+    size_t getPinCount() const { return pinCount; }
+    bool isFull() const { return pinCount >= MAX_PINS; }
+    // Pool record plus its share of both hash indexes and both schedules
+    static size_t getBytesPerCode() { return sizeof(AccessPin) + (2 * INDEX_SIZE * sizeof(uint16_t)) / MAX_PINS + 2 * 2 * sizeof(uint16_t); }
+    size_t getActiveCount() const { return activeCount; }
+    unsigned long getLastCleanupMicros() const { return lastCleanupMicros; }
+    unsigned long getLoadMillis() const { return loadMillis; }
+    unsigned long getMaxCleanupMicros() const { return maxCleanupMicros; }
+
 private:
-    std::vector<AccessPin> pins;
-    void createPin(int id, String code, unsigned long start, unsigned long end);
-    void updatePin(int id, String code, unsigned long start, unsigned long end);
+    // Open-addressing (linear probing) hash indexes: code -> position and
+    // id -> position in pins. Sized to the next power of two >= 2 * MAX_PINS
+    // to keep probe chains short.
+    static const uint16_t INDEX_SIZE = accessIndexSizeFor(MAX_PINS);
+    static const uint16_t INDEX_MASK = INDEX_SIZE - 1;
+    static const uint16_t INDEX_EMPTY = 0xFFFF;
+
+    AccessPin pins[MAX_PINS];
+    uint16_t pinCount;
+    uint16_t codeIndex[INDEX_SIZE];
+    uint16_t idIndex[INDEX_SIZE];      // ids are unique, so lookups stop at the first match
+
+    PinSchedule expirySchedule;      // every pin, keyed on end
+    PinSchedule activationSchedule;  // pins not yet active, keyed on start
+    size_t activeCount;
+    unsigned long lastCleanupMicros;
+    unsigned long maxCleanupMicros;
+
+    uint32_t syncSeq;
+
+    // Paged sync staging state (stageNextPart == 0 means no batch in progress)
+    char stageBatch[24];
+    uint16_t stageNextPart;
+    uint16_t stageParts;
+    uint16_t stageRecords;
+    bool stageTruncated;
+
+    // Append-only persistence log on LittleFS, compacted into a snapshot
+    // once it holds too many superseded records. On flash that is at most
+    // 2 * MAX_PINS + 65 records, plus MAX_PINS + 1 each in /pins.tmp and
+    // /pins.stage (README "Flash budget" sums it against the partition).
+    uint16_t logRecords;
+    unsigned long loadMillis;
+
+    static const uint16_t NOT_FOUND = 0xFFFF;
+
+    bool createPin(int id, const char* code, unsigned long start, unsigned long end);
+    void updatePin(int id, const char* code, unsigned long start, unsigned long end);
     void deletePin(int id);
+    uint16_t findById(int id) const;
+    void removeAt(uint16_t pos);
+    void loadLog();
+    void logPut(uint16_t pos);
+    void logDelete(int id);
+    void logSeq();
+    void appendLog(uint8_t op, const AccessPin& pin);
+    void compactLog();
+    void scheduleClear();
+    void scheduleInsert(uint16_t pos);
+    void scheduleUpdate(uint16_t pos);
+
+    static uint16_t hashCode(const char* code);
+    static uint16_t hashId(uint16_t id);
+    // Index helpers work on either table; the home slot of an entry is the
+    // hash of its code in codeIndex and of its id in idIndex
+    uint16_t indexHome(const uint16_t* table, uint16_t pos) const;
+    void indexClear();
+    void indexInsert(uint16_t* table, uint16_t pos);
+    void indexRemove(uint16_t* table, uint16_t pos);
+    void indexReplace(uint16_t* table, uint16_t from, uint16_t to);
+    uint16_t indexFind(const uint16_t* table, uint16_t pos) const;
 };
 
 #endif
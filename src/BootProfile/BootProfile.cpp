@@ -0,0 +1,28 @@
+#include "BootProfile.h"
+
+static const char* const PHASE_NAMES[BootProfile::PHASE_COUNT] = {
+    "core", "config", "io", "wifi-start", "storage", "wifi", "mqtt", "ap"
+};
+
+BootProfile::BootProfile() {
+    memset(marks, 0, sizeof(marks));
+}
+
+void BootProfile::mark(Phase phase) {
+    if (marks[phase] == 0) {
+        unsigned long now = millis();
+        marks[phase] = now > 0 ? now : 1;
+    }
+}
+
+const char* BootProfile::getName(Phase phase) {
+    return phase < PHASE_COUNT ? PHASE_NAMES[phase] : "";
+}
+
+void BootProfile::addTo(JsonObject target) const {
+    for (uint8_t i = 0; i < PHASE_COUNT; i++) {
+        if (marks[i] != 0) {
+            target[PHASE_NAMES[i]] = marks[i];
+        }
+    }
+}
@@ -0,0 +1,36 @@
+#ifndef BOOTPROFILE_H
+#define BOOTPROFILE_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+// When each boot phase finished, in ms of millis() (which starts with the
+// core, a few tens of ms after power-on). setup() phases run in order;
+// WiFi, MQTT and the access point come up later, from loop().
+class BootProfile {
+public:
+    enum Phase : uint8_t {
+        PHASE_CORE,         // entry to setup()
+        PHASE_CONFIG,       // EEPROM config loaded
+        PHASE_IO,           // relay and sensor pins ready
+        PHASE_WIFI_START,   // LittleFS mounted and station association started
+        PHASE_STORAGE,      // web server, access codes and event journal
+        PHASE_WIFI,         // first IP address
+        PHASE_MQTT,         // first broker session
+        PHASE_AP,           // access point and captive DNS
+        PHASE_COUNT
+    };
+
+    BootProfile();
+    // Only the first mark of a phase counts
+    void mark(Phase phase);
+    unsigned long getMark(Phase phase) const { return marks[phase]; }
+    static const char* getName(Phase phase);
+    // Adds "name": ms for every phase reached so far
+    void addTo(JsonObject target) const;
+
+private:
+    unsigned long marks[PHASE_COUNT];
+};
+
+#endif
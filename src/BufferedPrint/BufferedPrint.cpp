@@ -0,0 +1,32 @@
+#include "BufferedPrint.h"
+
+const size_t BufferedPrint::OUTPUT_SIZE;
+
+BufferedPrint::BufferedPrint(SinkFn sink) : sink(sink), outputLength(0) {
+}
+
+size_t BufferedPrint::write(uint8_t c) {
+    if (outputLength == OUTPUT_SIZE) flush();
+    output[outputLength++] = c;
+    return 1;
+}
+
+size_t BufferedPrint::write(const uint8_t* data, size_t length) {
+    size_t remaining = length;
+    while (remaining > 0) {
+        if (outputLength == OUTPUT_SIZE) flush();
+        size_t n = OUTPUT_SIZE - outputLength < remaining ? OUTPUT_SIZE - outputLength : remaining;
+        memcpy(output + outputLength, data, n);
+        outputLength += n;
+        data += n;
+        remaining -= n;
+    }
+    return length;
+}
+
+void BufferedPrint::flush() {
+    if (outputLength > 0) {
+        sink(output, outputLength);
+        outputLength = 0;
+    }
+}
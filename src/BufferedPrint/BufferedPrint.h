@@ -0,0 +1,29 @@
+#ifndef BUFFEREDPRINT_H
+#define BUFFEREDPRINT_H
+
+#include <Arduino.h>
+
+// Collects printed bytes in a fixed buffer and hands them to the sink each
+// time it fills, so a serializer that writes a few bytes at a time turns
+// into a handful of full-sized network writes. Memory use does not depend
+// on how much is printed.
+class BufferedPrint : public Print {
+public:
+    typedef void (*SinkFn)(const char* data, size_t length);
+
+    explicit BufferedPrint(SinkFn sink);
+    void flush() override;
+
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* data, size_t length) override;
+    using Print::write;
+
+    static const size_t OUTPUT_SIZE = 256;
+
+private:
+    SinkFn sink;
+    char output[OUTPUT_SIZE];
+    size_t outputLength;
+};
+
+#endif
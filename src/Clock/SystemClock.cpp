@@ -1,4 +1,5 @@
 #include "SystemClock.h"
+#include <sys/time.h>
 
 SystemClock::SystemClock() : _lastSyncUnixTime(0), _lastSyncMillis(0), _lastNtpSyncMillis(0) {
     // Constructor initializes with 0, meaning time is not yet set.
@@ -21,6 +22,16 @@ unsigned long SystemClock::getUnixTime() {
     return _lastSyncUnixTime + elapsedSeconds;
 }
 
+// Millisecond wall clock straight from SNTP, for latency tracing; 0 until synced
+uint64_t SystemClock::getUnixMillis() {
+    if (_lastSyncUnixTime == 0) {
+        return 0;
+    }
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    return (uint64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+}
+
 void SystemClock::setupNtp() {
     // UTC-3 for Brazil, no daylight saving (0)
     configTime(-3 * 3600, 0, "pool.ntp.org", "time.nist.gov");
@@ -9,6 +9,7 @@ public:
     SystemClock();
     void sync(unsigned long unix_time);
     unsigned long getUnixTime();
+    uint64_t getUnixMillis();
     void setupNtp();
     void loop();
 
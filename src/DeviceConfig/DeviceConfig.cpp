@@ -1,12 +1,17 @@
 #include <Arduino.h>
 #include <EEPROM.h>
 #include <ArduinoJson.h>
+#include <IPAddress.h>
 #include "version.h"
 #include "DeviceConfig.h"
 
 const char DeviceConfig::defaultDeviceName[] = "ESP-PORTATEC";
 const char DeviceConfig::defaultPassword[] = "123456789";
 const char* DeviceConfig::FIRMWARE_VERSION = FIRMWARE_VERSION_STR;
+const uint16_t DeviceConfig::DEFAULT_PULSE_WIDTH;
+const uint16_t DeviceConfig::MIN_PULSE_WIDTH;
+const uint16_t DeviceConfig::MAX_PULSE_WIDTH;
+const uint8_t DeviceConfig::WIFI_NETWORKS;
 
 // Legacy struct for migration from binary format
 #pragma pack(push, 1)
@@ -28,7 +33,7 @@ DeviceConfig::DeviceConfig() : configured(false) {
 }
 
 void DeviceConfig::begin() {
-    EEPROM.begin(512);
+    EEPROM.begin(EEPROM_SIZE);
     loadConfig();
 }
 
@@ -37,14 +42,25 @@ void DeviceConfig::initDefaultConfig() {
     strcpy(wifiPassword, defaultPassword);
     wifiSSID[0] = '\0';
     wifiNetworkPass[0] = '\0';
+    for (uint8_t i = 0; i < WIFI_NETWORKS - 1; i++) {
+        wifiFallbackSSID[i][0] = '\0';
+        wifiFallbackPass[i][0] = '\0';
+    }
+    wifiStaticIp[0] = '\0';
+    wifiGateway[0] = '\0';
+    wifiSubnet[0] = '\0';
     pulsePin = 3;
     sensorPin = UNCONFIGURED_PIN;
     pulseInverted = false;
+    pulseWidth = DEFAULT_PULSE_WIDTH;
     strcpy(pin, "123456");
     strcpy(mqttHost, "portatec.medeirostec.com.br");  // Default broker
     mqttPort = 1883;
     mqttUser[0] = '\0';
     mqttPassword[0] = '\0';
+    mqttMsgPack = false;
+    mqttTls = false;
+    mqttFingerprint[0] = '\0';
 }
 
 void DeviceConfig::loadConfig() {
@@ -77,9 +93,18 @@ void DeviceConfig::loadConfig() {
         wifiSSID[sizeof(wifiSSID) - 1] = '\0';
         v = doc["wifiNetworkPass"].as<const char*>(); strncpy(wifiNetworkPass, v ? v : "", sizeof(wifiNetworkPass) - 1);
         wifiNetworkPass[sizeof(wifiNetworkPass) - 1] = '\0';
+        for (uint8_t i = 0; i < WIFI_NETWORKS - 1; i++) {
+            char ssidKey[12];
+            char passKey[20];
+            snprintf(ssidKey, sizeof(ssidKey), "wifiSSID%u", i + 2);
+            snprintf(passKey, sizeof(passKey), "wifiNetworkPass%u", i + 2);
+            setWifiFallback(i, doc[ssidKey] | "", doc[passKey] | "");
+        }
+        setWifiStaticIp(doc["wifiStaticIp"] | "", doc["wifiGateway"] | "", doc["wifiSubnet"] | "");
         pulsePin = doc.containsKey("pulsePin") ? (int)doc["pulsePin"] : 3;
         sensorPin = doc.containsKey("sensorPin") ? (int)doc["sensorPin"] : UNCONFIGURED_PIN;
         pulseInverted = doc["pulseInverted"].as<bool>();
+        setPulseWidth(doc["pulseWidth"] | DEFAULT_PULSE_WIDTH);
         v = doc["pin"].as<const char*>(); strncpy(pin, v ? v : "123456", sizeof(pin) - 1);
         pin[sizeof(pin) - 1] = '\0';
         v = doc["mqttHost"].as<const char*>(); strncpy(mqttHost, v ? v : "", sizeof(mqttHost) - 1);
@@ -89,6 +114,9 @@ void DeviceConfig::loadConfig() {
         mqttUser[sizeof(mqttUser) - 1] = '\0';
         v = doc["mqttPassword"].as<const char*>(); strncpy(mqttPassword, v ? v : "", sizeof(mqttPassword) - 1);
         mqttPassword[sizeof(mqttPassword) - 1] = '\0';
+        mqttMsgPack = doc["mqttMsgPack"].as<bool>();
+        mqttTls = doc["mqttTls"].as<bool>();
+        setMqttFingerprint(doc["mqttFingerprint"] | "");
 
         configured = (strlen(wifiSSID) > 0);
         return;
@@ -113,42 +141,75 @@ void DeviceConfig::loadConfig() {
     wifiSSID[sizeof(wifiSSID) - 1] = '\0';
     strncpy(wifiNetworkPass, legacy.wifiNetworkPass, sizeof(wifiNetworkPass) - 1);
     wifiNetworkPass[sizeof(wifiNetworkPass) - 1] = '\0';
+    for (uint8_t i = 0; i < WIFI_NETWORKS - 1; i++) {
+        wifiFallbackSSID[i][0] = '\0';
+        wifiFallbackPass[i][0] = '\0';
+    }
+    wifiStaticIp[0] = '\0';
+    wifiGateway[0] = '\0';
+    wifiSubnet[0] = '\0';
     pulsePin = legacy.pulsePin;
     sensorPin = legacy.sensorPin;
     pulseInverted = legacy.pulseInverted;
+    pulseWidth = DEFAULT_PULSE_WIDTH;
     strncpy(pin, legacy.pin, sizeof(pin) - 1);
     pin[sizeof(pin) - 1] = '\0';
     strcpy(mqttHost, "portatec.medeirostec.com.br");  // Default for migrated devices
     mqttPort = 1883;
     mqttUser[0] = '\0';
     mqttPassword[0] = '\0';
+    mqttMsgPack = false;
+    mqttTls = false;
+    mqttFingerprint[0] = '\0';
 
     configured = true;
     saveConfig();  // Save in new JSON format
 }
 
 void DeviceConfig::saveConfig() {
-    DynamicJsonDocument doc(CONFIG_MAX_SIZE);
+    // Values are copied into the document here (loading parses in place),
+    // so a full config needs more than its serialized size
+    DynamicJsonDocument doc(CONFIG_MAX_SIZE + 256);
     doc["deviceName"] = deviceName;
     doc["wifiPassword"] = wifiPassword;
     doc["wifiSSID"] = wifiSSID;
     doc["wifiNetworkPass"] = wifiNetworkPass;
+    for (uint8_t i = 0; i < WIFI_NETWORKS - 1; i++) {
+        if (wifiFallbackSSID[i][0] == '\0') continue;
+        char ssidKey[12];
+        char passKey[20];
+        snprintf(ssidKey, sizeof(ssidKey), "wifiSSID%u", i + 2);
+        snprintf(passKey, sizeof(passKey), "wifiNetworkPass%u", i + 2);
+        doc[ssidKey] = wifiFallbackSSID[i];
+        doc[passKey] = wifiFallbackPass[i];
+    }
+    if (wifiStaticIp[0] != '\0') {
+        doc["wifiStaticIp"] = wifiStaticIp;
+        doc["wifiGateway"] = wifiGateway;
+        doc["wifiSubnet"] = wifiSubnet;
+    }
     doc["pulsePin"] = pulsePin;
     doc["sensorPin"] = sensorPin;
     doc["pulseInverted"] = pulseInverted;
+    doc["pulseWidth"] = pulseWidth;
     doc["pin"] = pin;
     doc["mqttHost"] = mqttHost;
     doc["mqttPort"] = mqttPort;
     doc["mqttUser"] = mqttUser;
     doc["mqttPassword"] = mqttPassword;
+    doc["mqttMsgPack"] = mqttMsgPack;
+    doc["mqttTls"] = mqttTls;
+    doc["mqttFingerprint"] = mqttFingerprint;
 
     String output;
     serializeJson(doc, output);
 
-    for (size_t i = 0; i < output.length() && i < CONFIG_MAX_SIZE - 1; i++) {
+    // Never past CONFIG_MAX_SIZE
+    size_t length = output.length() < CONFIG_MAX_SIZE - 1 ? output.length() : CONFIG_MAX_SIZE - 1;
+    for (size_t i = 0; i < length; i++) {
         EEPROM.write(CONFIG_ADDRESS + i, output[i]);
     }
-    EEPROM.write(CONFIG_ADDRESS + output.length(), '\0');
+    EEPROM.write(CONFIG_ADDRESS + length, '\0');
     EEPROM.commit();
 }
 
@@ -174,6 +235,12 @@ void DeviceConfig::setPulseInverted(bool inverted) {
     pulseInverted = inverted;
 }
 
+void DeviceConfig::setPulseWidth(uint16_t widthMs) {
+    if (widthMs < MIN_PULSE_WIDTH) widthMs = MIN_PULSE_WIDTH;
+    if (widthMs > MAX_PULSE_WIDTH) widthMs = MAX_PULSE_WIDTH;
+    pulseWidth = widthMs;
+}
+
 void DeviceConfig::setWifiSSID(const char* ssid) {
     strncpy(wifiSSID, ssid, sizeof(wifiSSID) - 1);
     wifiSSID[sizeof(wifiSSID) - 1] = '\0';
@@ -184,6 +251,40 @@ void DeviceConfig::setWifiNetworkPass(const char* password) {
     wifiNetworkPass[sizeof(wifiNetworkPass) - 1] = '\0';
 }
 
+const char* DeviceConfig::getWifiSSID(uint8_t index) const {
+    if (index == 0) return wifiSSID;
+    return index < WIFI_NETWORKS ? wifiFallbackSSID[index - 1] : "";
+}
+
+const char* DeviceConfig::getWifiNetworkPass(uint8_t index) const {
+    if (index == 0) return wifiNetworkPass;
+    return index < WIFI_NETWORKS ? wifiFallbackPass[index - 1] : "";
+}
+
+void DeviceConfig::setWifiFallback(uint8_t index, const char* ssid, const char* password) {
+    if (index >= WIFI_NETWORKS - 1) return;
+    strncpy(wifiFallbackSSID[index], ssid, sizeof(wifiFallbackSSID[index]) - 1);
+    wifiFallbackSSID[index][sizeof(wifiFallbackSSID[index]) - 1] = '\0';
+    strncpy(wifiFallbackPass[index], password, sizeof(wifiFallbackPass[index]) - 1);
+    wifiFallbackPass[index][sizeof(wifiFallbackPass[index]) - 1] = '\0';
+}
+
+// All three addresses must parse, otherwise the device stays on DHCP
+void DeviceConfig::setWifiStaticIp(const char* ip, const char* gateway, const char* subnet) {
+    IPAddress parsed;
+    if (!parsed.fromString(ip) || !parsed.fromString(gateway) || !parsed.fromString(subnet)
+        || strlen(ip) >= sizeof(wifiStaticIp) || strlen(gateway) >= sizeof(wifiGateway)
+        || strlen(subnet) >= sizeof(wifiSubnet)) {
+        wifiStaticIp[0] = '\0';
+        wifiGateway[0] = '\0';
+        wifiSubnet[0] = '\0';
+        return;
+    }
+    strcpy(wifiStaticIp, ip);
+    strcpy(wifiGateway, gateway);
+    strcpy(wifiSubnet, subnet);
+}
+
 void DeviceConfig::setPin(const char* pinCode) {
     strncpy(pin, pinCode, sizeof(pin) - 1);
     pin[sizeof(pin) - 1] = '\0';
@@ -207,3 +308,30 @@ void DeviceConfig::setMqttPassword(const char* password) {
     strncpy(mqttPassword, password, sizeof(mqttPassword) - 1);
     mqttPassword[sizeof(mqttPassword) - 1] = '\0';
 }
+
+void DeviceConfig::setMqttMsgPack(bool enabled) {
+    mqttMsgPack = enabled;
+}
+
+void DeviceConfig::setMqttTls(bool enabled) {
+    mqttTls = enabled;
+}
+
+// Accepts the fingerprint as printed by openssl ("AB:CD:...") and stores
+// only the hex digits. Anything but exactly 40 of them (or an empty input,
+// which turns pinning off) is refused and leaves the stored one unchanged:
+// a typo must not quietly downgrade the link to an unverified broker.
+bool DeviceConfig::setMqttFingerprint(const char* fingerprint) {
+    char digits[sizeof(mqttFingerprint)];
+    size_t length = 0;
+    for (const char* c = fingerprint; *c; c++) {
+        if (*c == ':' || *c == ' ' || *c == '-') continue;
+        if (!isxdigit((unsigned char)*c) || length == sizeof(digits) - 1) return false;
+        digits[length++] = toupper((unsigned char)*c);
+    }
+    bool blank = fingerprint[strspn(fingerprint, " ")] == '\0';
+    if (length != sizeof(digits) - 1 && !(length == 0 && blank)) return false;
+    digits[length] = '\0';
+    memcpy(mqttFingerprint, digits, length + 1);
+    return true;
+}
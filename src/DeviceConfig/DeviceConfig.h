@@ -7,7 +7,8 @@
 class DeviceConfig {
 private:
     static const int CONFIG_ADDRESS = 0;
-    static const int CONFIG_MAX_SIZE = 480;
+    static const int EEPROM_SIZE = 1024;      // grown from 768 for the fallback networks; the JSON stays at offset 0
+    static const int CONFIG_MAX_SIZE = 992;   // the last 32 bytes once held the WiFi cache, now in LittleFS
     static const uint32_t CONFIG_SIGNATURE = 0x504F5254;  // "PORT"
     static const uint8_t CONFIG_VERSION_STRUCT = 5;
     static const uint8_t CONFIG_VERSION_JSON = 6;
@@ -19,21 +20,34 @@ private:
 
 public:
     static const uint8_t UNCONFIGURED_PIN = 255;
+    static const uint16_t DEFAULT_PULSE_WIDTH = 500;
+    static const uint16_t MIN_PULSE_WIDTH = 50;
+    static const uint16_t MAX_PULSE_WIDTH = 10000;
     static const char* FIRMWARE_VERSION;
+    static const uint8_t WIFI_NETWORKS = 3;   // the primary network plus two fallbacks, in priority order
 
     // In-memory config (loaded from JSON)
     char deviceName[32];
     char wifiPassword[32];
     char wifiSSID[32];
     char wifiNetworkPass[32];
+    char wifiFallbackSSID[WIFI_NETWORKS - 1][32];
+    char wifiFallbackPass[WIFI_NETWORKS - 1][32];
+    char wifiStaticIp[16];      // empty for DHCP; applies to the primary network only
+    char wifiGateway[16];
+    char wifiSubnet[16];
     uint8_t pulsePin;
     uint8_t sensorPin;
     bool pulseInverted;
+    uint16_t pulseWidth;
     char pin[7];
     char mqttHost[64];
     uint16_t mqttPort;
     char mqttUser[32];
     char mqttPassword[32];
+    bool mqttMsgPack;
+    bool mqttTls;
+    char mqttFingerprint[41];   // SHA-1 of the broker certificate, 40 hex digits
 
     DeviceConfig();
     void begin();
@@ -42,26 +56,43 @@ public:
     const char* getPassword() const { return wifiPassword; }
     const char* getWifiSSID() const { return wifiSSID; }
     const char* getWifiNetworkPass() const { return wifiNetworkPass; }
+    // Network by priority, 0 being the primary; empty SSID if unset
+    const char* getWifiSSID(uint8_t index) const;
+    const char* getWifiNetworkPass(uint8_t index) const;
+    const char* getWifiStaticIp() const { return wifiStaticIp; }
+    const char* getWifiGateway() const { return wifiGateway; }
+    const char* getWifiSubnet() const { return wifiSubnet; }
     uint8_t getPulsePin() const { return pulsePin; }
     uint8_t getSensorPin() const { return sensorPin; }
     bool getPulseInverted() const { return pulseInverted; }
+    uint16_t getPulseWidth() const { return pulseWidth; }
     const char* getPin() const { return pin; }
     const char* getMqttHost() const { return mqttHost; }
     uint16_t getMqttPort() const { return mqttPort; }
     const char* getMqttUser() const { return mqttUser; }
     const char* getMqttPassword() const { return mqttPassword; }
+    bool getMqttMsgPack() const { return mqttMsgPack; }
+    bool getMqttTls() const { return mqttTls; }
+    const char* getMqttFingerprint() const { return mqttFingerprint; }
     void setDeviceName(const char* name);
     void setPassword(const char* password);
     void setWifiSSID(const char* ssid);
     void setWifiNetworkPass(const char* password);
+    void setWifiFallback(uint8_t index, const char* ssid, const char* password);
+    void setWifiStaticIp(const char* ip, const char* gateway, const char* subnet);
     void setPulsePin(uint8_t pin);
     void setSensorPin(uint8_t pin);
     void setPulseInverted(bool inverted);
+    void setPulseWidth(uint16_t widthMs);
     void setPin(const char* pin);
     void setMqttHost(const char* host);
     void setMqttPort(uint16_t port);
     void setMqttUser(const char* user);
     void setMqttPassword(const char* password);
+    void setMqttMsgPack(bool enabled);
+    void setMqttTls(bool enabled);
+    // False (nothing stored) unless empty or 40 hex digits
+    bool setMqttFingerprint(const char* fingerprint);
     void initDefaultConfig();
     void loadConfig();
     void saveConfig();
@@ -0,0 +1,172 @@
+#include "EventJournal.h"
+#include "../globals.h"
+#include <LittleFS.h>
+
+static const char EVENT_LOG_PATH[] = "/events.log";
+static const char EVENT_POS_PATH[] = "/events.pos";   // fileOffset, 4 bytes
+
+EventJournal::EventJournal()
+    : ramHead(0), ramCount(0), fileRecords(0), fileOffset(0),
+      nextSeq(1), droppedCount(0), bootId(0),
+      peekBoot(0), peekSeq(0), peekCount(0) {
+}
+
+void EventJournal::begin() {
+    bootId = ESP.random();
+
+    File file = LittleFS.open(EVENT_LOG_PATH, "r");
+    if (!file) {
+        LittleFS.remove(EVENT_POS_PATH);
+        return;
+    }
+    uint32_t size = file.size();
+    file.close();
+
+    uint32_t offset = 0;
+    File position = LittleFS.open(EVENT_POS_PATH, "r");
+    if (position) {
+        if (position.read((uint8_t*)&offset, sizeof(offset)) != sizeof(offset)
+            || offset > size || offset % sizeof(AccessEvent) != 0) {
+            offset = 0;   // unusable position: resend the whole file
+        }
+        position.close();
+    }
+    fileOffset = offset;
+    fileRecords = (size - offset) / sizeof(AccessEvent);
+    if (fileRecords == 0) {
+        clearFile();
+        return;
+    }
+
+    DEBUG_PRINT("[EventJournal] Pending events from previous boot: ");
+    DEBUG_PRINTLN(fileRecords);
+}
+
+void EventJournal::append(const char* code, bool valid, unsigned long timestamp) {
+    if (ramCount == RAM_CAPACITY) {
+        spill();
+    }
+    if (ramCount == RAM_CAPACITY) {
+        // Filesystem full or unavailable: keep the older, undelivered history
+        droppedCount++;
+        return;
+    }
+
+    AccessEvent& event = ring[(ramHead + ramCount) % RAM_CAPACITY];
+    event.boot = bootId;
+    event.seq = nextSeq++;
+    event.timestamp = timestamp;
+    strncpy(event.code, code ? code : "", sizeof(event.code) - 1);
+    event.code[sizeof(event.code) - 1] = '\0';
+    event.valid = valid ? 1 : 0;
+    ramCount++;
+}
+
+// Moves the whole RAM ring to the end of the file. The file only ever holds
+// events older than those in RAM, so draining file-then-RAM keeps order.
+// Consumed records stay at the head of the file until it drains, so they
+// count against FILE_CAPACITY too: the file never exceeds 48 KB.
+void EventJournal::spill() {
+    if (fileOffset / sizeof(AccessEvent) + fileRecords + ramCount > FILE_CAPACITY) return;
+
+    File file = LittleFS.open(EVENT_LOG_PATH, "a");
+    if (!file) return;
+    while (ramCount > 0) {
+        if (file.write((const uint8_t*)&ring[ramHead], sizeof(AccessEvent)) != sizeof(AccessEvent)) break;
+        ramHead = (ramHead + 1) % RAM_CAPACITY;
+        ramCount--;
+        fileRecords++;
+    }
+    file.close();
+}
+
+uint8_t EventJournal::peek(AccessEvent* out, uint8_t max) {
+    if (fileRecords > 0) {
+        File file = LittleFS.open(EVENT_LOG_PATH, "r");
+        if (file && file.seek(fileOffset)) {
+            uint8_t count = 0;
+            while (count < max && count < fileRecords
+                   && file.read((uint8_t*)&out[count], sizeof(AccessEvent)) == sizeof(AccessEvent)) {
+                count++;
+            }
+            file.close();
+            if (count > 0) {
+                peekBoot = out[0].boot;
+                peekSeq = out[0].seq;
+                peekCount = count;
+                return count;
+            }
+        }
+        // Unreadable remainder (e.g. torn last record): discard it
+        clearFile();
+    }
+
+    uint8_t count = 0;
+    while (count < max && count < ramCount) {
+        out[count] = ring[(ramHead + count) % RAM_CAPACITY];
+        count++;
+    }
+    peekCount = count;
+    if (count > 0) {
+        peekBoot = out[0].boot;
+        peekSeq = out[0].seq;
+    }
+    return count;
+}
+
+// A peeked batch is always the oldest pending events, and a spill keeps
+// their order, so after checking the head it is the count oldest events,
+// from the file first, whichever side of a spill they are on now.
+void EventJournal::consume(uint8_t count) {
+    if (count > peekCount) count = peekCount;
+    peekCount = 0;
+
+    AccessEvent oldest;
+    if (count == 0 || !readOldest(oldest) || oldest.boot != peekBoot || oldest.seq != peekSeq) {
+        DEBUG_PRINTLN("[EventJournal] Published batch is no longer pending, nothing consumed");
+        return;
+    }
+
+    uint8_t fromFile = count < fileRecords ? count : (uint8_t)fileRecords;
+    if (fromFile > 0) {
+        fileRecords -= fromFile;
+        fileOffset += fromFile * sizeof(AccessEvent);
+        if (fileRecords == 0) {
+            clearFile();
+        } else {
+            saveOffset();
+        }
+        count -= fromFile;
+    }
+
+    if (count > ramCount) count = ramCount;
+    ramHead = (ramHead + count) % RAM_CAPACITY;
+    ramCount -= count;
+}
+
+bool EventJournal::readOldest(AccessEvent& out) {
+    if (fileRecords > 0) {
+        File file = LittleFS.open(EVENT_LOG_PATH, "r");
+        if (!file) return false;
+        bool found = file.seek(fileOffset) && file.read((uint8_t*)&out, sizeof(AccessEvent)) == sizeof(AccessEvent);
+        file.close();
+        return found;
+    }
+    if (ramCount == 0) return false;
+    out = ring[ramHead];
+    return true;
+}
+
+void EventJournal::saveOffset() {
+    File file = LittleFS.open(EVENT_POS_PATH, "w");
+    if (!file) return;
+    file.write((const uint8_t*)&fileOffset, sizeof(fileOffset));
+    file.close();
+}
+
+void EventJournal::clearFile() {
+    LittleFS.remove(EVENT_LOG_PATH);
+    LittleFS.remove(EVENT_POS_PATH);
+    fileRecords = 0;
+    fileOffset = 0;
+}
@@ -0,0 +1,62 @@
+#ifndef EVENTJOURNAL_H
+#define EVENTJOURNAL_H
+
+#include <Arduino.h>
+
+// (boot, seq) uniquely identifies an event; seq restarts on every boot
+struct AccessEvent {
+    uint32_t boot;
+    uint32_t seq;
+    uint32_t timestamp;
+    char code[8];
+    uint8_t valid;
+};
+
+// At-least-once journal for access events. New events go to a small RAM
+// ring; when it fills they spill (oldest first) to an append-only file on
+// LittleFS. Readers peek a batch of the oldest events and consume it only
+// after it was published, so nothing is lost while MQTT is down. The read
+// position in the file is persisted on every consume, so delivery is
+// at-least-once: a reboot mid-drain resends only the batch in flight.
+class EventJournal {
+public:
+    static const uint8_t RAM_CAPACITY = 16;
+    static const uint16_t FILE_CAPACITY = 2000;
+
+    EventJournal();
+    // Restore spilled events from LittleFS (call once the filesystem is mounted)
+    void begin();
+    void append(const char* code, bool valid, unsigned long timestamp);
+    // Copies up to max of the oldest pending events into out; returns how many
+    uint8_t peek(AccessEvent* out, uint8_t max);
+    // Drops the first count events returned by the last peek(). They are
+    // still the oldest pending ones even if a spill moved them to the file
+    // meanwhile; if they are gone (discarded file), nothing is dropped.
+    void consume(uint8_t count);
+
+    bool isEmpty() const { return ramCount == 0 && fileRecords == 0; }
+    uint32_t getPendingCount() const { return ramCount + fileRecords; }
+    uint32_t getDroppedCount() const { return droppedCount; }
+
+private:
+    AccessEvent ring[RAM_CAPACITY];
+    uint8_t ramHead;
+    uint8_t ramCount;
+    uint16_t fileRecords;      // records in the file not yet consumed
+    uint32_t fileOffset;       // byte offset of the first unconsumed record
+    uint32_t nextSeq;
+    uint32_t droppedCount;
+    uint32_t bootId;
+
+    // First event and size of the last peek(), checked by consume()
+    uint32_t peekBoot;
+    uint32_t peekSeq;
+    uint8_t peekCount;
+
+    void spill();
+    bool readOldest(AccessEvent& out);
+    void saveOffset();
+    void clearFile();
+};
+
+#endif
@@ -0,0 +1,102 @@
+#include "EventStream.h"
+#include "../globals.h"
+
+const uint8_t EventStream::MAX_SUBSCRIBERS;
+const unsigned long EventStream::HEARTBEAT_INTERVAL;
+const unsigned long EventStream::RETRY_MS;
+
+EventStream::EventStream() : nextId(0), droppedCount(0), lastWrite(0) {
+}
+
+bool EventStream::subscribe(WiFiClient& client) {
+    for (uint8_t i = 0; i < MAX_SUBSCRIBERS; i++) {
+        if (subscribers[i].connected()) continue;
+
+        char header[160];
+        int length = snprintf(header, sizeof(header),
+                              "HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\nCache-Control: no-store\r\n"
+                              "Connection: keep-alive\r\n\r\nretry: %lu\n\n", RETRY_MS);
+        client.setNoDelay(true);
+        // A client that cannot take the headers is dropped, which still
+        // answers the request
+        if (!writeTo(client, header, length)) return true;
+        subscribers[i] = client;
+        writeSensorState(subscribers[i]);
+        DEBUG_PRINT("[Events] Subscriber added, slot ");
+        DEBUG_PRINTLN(i);
+        return true;
+    }
+    return false;
+}
+
+void EventStream::loop() {
+    bool idle = millis() - lastWrite >= HEARTBEAT_INTERVAL;
+    for (uint8_t i = 0; i < MAX_SUBSCRIBERS; i++) {
+        if (!subscribers[i].connected()) {
+            subscribers[i] = WiFiClient();  // releases the connection
+            continue;
+        }
+        if (idle) writeTo(subscribers[i], ": hb\n\n", 6);
+    }
+    if (idle) lastWrite = millis();
+}
+
+// HIGH is a closed gate, as on the home page
+void EventStream::sendSensor(int value) {
+    broadcast("sensor", value == HIGH ? "{\"closed\":true}" : "{\"closed\":false}");
+}
+
+void EventStream::sendRelay(const char* state, const char* action, bool remote) {
+    char data[80];
+    snprintf(data, sizeof(data), "{\"state\":\"%s\",\"action\":\"%s\",\"source\":\"%s\"}", state, action,
+             remote ? "mqtt" : "web");
+    broadcast("relay", data);
+}
+
+// The PIN itself is left out: anyone on the local network may listen
+void EventStream::sendAccess(const char* result) {
+    char data[48];
+    snprintf(data, sizeof(data), "{\"result\":\"%s\"}", result);
+    broadcast("access", data);
+}
+
+uint8_t EventStream::getSubscriberCount() {
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < MAX_SUBSCRIBERS; i++) {
+        if (subscribers[i].connected()) count++;
+    }
+    return count;
+}
+
+void EventStream::broadcast(const char* event, const char* data) {
+    char message[160];
+    int length = snprintf(message, sizeof(message), "id: %lu\nevent: %s\ndata: %s\n\n", (unsigned long)++nextId,
+                          event, data);
+    if (length <= 0 || length >= (int)sizeof(message)) return;
+
+    for (uint8_t i = 0; i < MAX_SUBSCRIBERS; i++) {
+        if (subscribers[i].connected()) writeTo(subscribers[i], message, length);
+    }
+    lastWrite = millis();
+}
+
+// All or nothing, without waiting for the peer: a partial event would
+// corrupt the stream, so a full send buffer costs the subscriber instead
+bool EventStream::writeTo(WiFiClient& client, const char* text, size_t length) {
+    if ((size_t)client.availableForWrite() < length) {
+        DEBUG_PRINTLN("[Events] Subscriber too slow, dropping");
+        client.stop();
+        droppedCount++;
+        return false;
+    }
+    client.write((const uint8_t*)text, length);
+    return true;
+}
+
+void EventStream::writeSensorState(WiFiClient& client) {
+    if (deviceConfig.getSensorPin() == DeviceConfig::UNCONFIGURED_PIN) return;
+    const char* message = digitalRead(deviceConfig.getSensorPin()) == HIGH
+        ? "event: sensor\ndata: {\"closed\":true}\n\n"
+        : "event: sensor\ndata: {\"closed\":false}\n\n";
+    writeTo(client, message, strlen(message));
+}
@@ -0,0 +1,43 @@
+#ifndef EVENTSTREAM_H
+#define EVENTSTREAM_H
+
+#include <Arduino.h>
+#include <WiFiClient.h>
+
+// Server-Sent Events for the local UI. A subscriber's connection is taken
+// over from the web server and kept open; gate, relay and access events are
+// written to every subscriber as they happen. Writes never block: a
+// subscriber whose send buffer cannot take the whole event is disconnected,
+// and the browser's EventSource reconnects on its own.
+class EventStream {
+public:
+    EventStream();
+    // Answers the request with the stream headers and the current gate
+    // state. False if every slot is taken; the request is left untouched.
+    bool subscribe(WiFiClient& client);
+    // Drops closed connections and keeps idle ones alive with a comment
+    void loop();
+
+    void sendSensor(int value);
+    void sendRelay(const char* state, const char* action, bool remote);
+    void sendAccess(const char* result);
+
+    uint8_t getSubscriberCount();
+    uint32_t getDroppedCount() const { return droppedCount; }
+
+    static const uint8_t MAX_SUBSCRIBERS = 3;
+    static const unsigned long HEARTBEAT_INTERVAL = 15000;
+    static const unsigned long RETRY_MS = 3000;
+
+private:
+    WiFiClient subscribers[MAX_SUBSCRIBERS];
+    uint32_t nextId;
+    uint32_t droppedCount;
+    unsigned long lastWrite;
+
+    void broadcast(const char* event, const char* data);
+    bool writeTo(WiFiClient& client, const char* text, size_t length);
+    void writeSensorState(WiFiClient& client);
+};
+
+#endif
@@ -0,0 +1,46 @@
+#include "InboundParser.h"
+
+InboundParser::Route InboundParser::route(const char* topic, const char* prefix, size_t prefixLength) {
+    if (strncmp(topic, prefix, prefixLength) != 0) return ROUTE_IGNORED;
+    const char* suffix = topic + prefixLength;
+    if (strcmp(suffix, "command") == 0) return ROUTE_COMMAND;
+    if (strcmp(suffix, "access-codes/sync") == 0) return ROUTE_ACCESS_CODES;
+    if (strcmp(suffix, "echo") == 0) return ROUTE_ECHO;
+    return ROUTE_IGNORED;
+}
+
+bool InboundParser::isMsgPack(const uint8_t* payload, unsigned int length) {
+    return length > 0 && ((payload[0] & 0xF0) == 0x80 || payload[0] == 0xDE || payload[0] == 0xDF);
+}
+
+DeserializationError InboundParser::parse(JsonDocument& doc, Route route, bool msgPack, uint8_t* payload,
+                                          unsigned int length) {
+    char* input = (char*)payload;
+    if (route == ROUTE_ACCESS_CODES) {
+        DeserializationOption::Filter filter(accessCodesFilter(msgPack));
+        return msgPack ? deserializeMsgPack(doc, input, length, filter) : deserializeJson(doc, input, length, filter);
+    }
+    return msgPack ? deserializeMsgPack(doc, input, length) : deserializeJson(doc, input, length);
+}
+
+// The compact filter lets access_codes entries through whole, since in
+// MessagePack mode they are [id, pin, start_unix, end_unix] tuples
+JsonDocument& InboundParser::accessCodesFilter(bool compact) {
+    static StaticJsonDocument<384> filter;
+    static StaticJsonDocument<384> compactFilter;
+    JsonDocument& selected = compact ? compactFilter : filter;
+    if (selected.isNull()) {
+        for (const char* key : {"action", "command_id", "seq", "batch", "part", "parts", "op", "id", "pin",
+                                "start_unix", "end_unix", "start", "end"}) {
+            selected[key] = true;
+        }
+        if (compact) {
+            selected["access_codes"] = true;
+        } else {
+            for (const char* key : {"id", "pin", "start_unix", "end_unix", "start", "end"}) {
+                selected["access_codes"][0][key] = true;
+            }
+        }
+    }
+    return selected;
+}
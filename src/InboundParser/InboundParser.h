@@ -0,0 +1,36 @@
+#ifndef INBOUNDPARSER_H
+#define INBOUNDPARSER_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+// Routing and parsing of inbound MQTT messages, the part of
+// Sync::mqttCallback that does not touch the network. Topics are routed by
+// comparing only the suffix after the precomputed "device/{id}/" prefix, and
+// payloads are parsed in place (ArduinoJson zero-copy mode) into the caller's
+// preallocated document, so neither step uses the heap. Strings in the
+// document point into the payload, which must outlive them.
+class InboundParser {
+public:
+    enum Route : uint8_t {
+        ROUTE_IGNORED,        // not one of this device's subscriptions
+        ROUTE_ECHO,           // RTT probe coming back, not parsed
+        ROUTE_COMMAND,
+        ROUTE_ACCESS_CODES
+    };
+
+    // prefixLength is the length of "device/{id}/" at the start of prefix
+    static Route route(const char* topic, const char* prefix, size_t prefixLength);
+    // A MessagePack map starts with fixmap (0x80-0x8f), map16 or map32;
+    // anything else is taken as JSON
+    static bool isMsgPack(const uint8_t* payload, unsigned int length);
+    // Access-code messages go through a filter, so unknown keys never take
+    // space in the document and every byte goes to codes
+    static DeserializationError parse(JsonDocument& doc, Route route, bool msgPack, uint8_t* payload,
+                                      unsigned int length);
+
+private:
+    static JsonDocument& accessCodesFilter(bool compact);
+};
+
+#endif
@@ -0,0 +1,168 @@
+#include <PubSubClient.h>
+#include "LinkMonitor.h"
+#include "../globals.h"
+
+const uint16_t LinkMonitor::MIN_KEEPALIVE;
+const uint16_t LinkMonitor::MAX_KEEPALIVE;
+
+LinkMonitor::LinkMonitor()
+    : sampleNext(0), sampleCount(0), probeId(0), probeSentAt(0),
+      probeOutstanding(false), lastProbe(0), lostProbes(0),
+      keepAlive(MIN_KEEPALIVE), linkUp(false), stableSince(0), failures(0), lastAttempt(0),
+      reconnectDelay(0), reconnects(0) {
+    memset(samples, 0, sizeof(samples));
+    resetReported();
+}
+
+bool LinkMonitor::probeDue() const {
+    return !probeOutstanding && millis() - lastProbe >= PROBE_INTERVAL;
+}
+
+uint32_t LinkMonitor::startProbe() {
+    lastProbe = millis();
+    probeSentAt = lastProbe;
+    probeOutstanding = true;
+    return ++probeId;
+}
+
+void LinkMonitor::onEcho(const byte* payload, unsigned int length) {
+    if (!probeOutstanding) return;
+
+    uint32_t id = 0;
+    for (unsigned int i = 0; i < length; i++) {
+        if (payload[i] < '0' || payload[i] > '9') return;
+        id = id * 10 + (payload[i] - '0');
+    }
+    if (id != probeId) return;  // a late echo of a probe already counted as lost
+
+    unsigned long rtt = millis() - probeSentAt;
+    samples[sampleNext] = rtt > 0xFFFF ? 0xFFFF : rtt;
+    sampleNext = (sampleNext + 1) % RTT_WINDOW;
+    if (sampleCount < RTT_WINDOW) sampleCount++;
+    probeOutstanding = false;
+}
+
+void LinkMonitor::loop() {
+    if (probeOutstanding && millis() - probeSentAt >= PROBE_TIMEOUT) {
+        DEBUG_PRINTLN("[Link] Probe lost");
+        probeOutstanding = false;
+        lostProbes++;
+        stableSince = millis();
+    }
+
+    if (linkUp && keepAlive > MIN_KEEPALIVE && millis() - stableSince >= STABLE_SESSION) {
+        keepAlive -= KEEPALIVE_STEP;
+        stableSince = millis();
+    }
+}
+
+uint16_t LinkMonitor::getRttPercentile(uint8_t percent) const {
+    if (sampleCount == 0) return 0;
+
+    uint16_t sorted[RTT_WINDOW];
+    for (uint8_t i = 0; i < sampleCount; i++) {
+        uint16_t value = samples[i];
+        uint8_t j = i;
+        while (j > 0 && sorted[j - 1] > value) {
+            sorted[j] = sorted[j - 1];
+            j--;
+        }
+        sorted[j] = value;
+    }
+    uint8_t rank = (uint16_t)(sampleCount - 1) * percent / 100;
+    return sorted[rank];
+}
+
+bool LinkMonitor::reconnectDue() const {
+    return millis() - lastAttempt >= reconnectDelay;
+}
+
+void LinkMonitor::onConnected() {
+    failures = 0;
+    reconnectDelay = 0;
+    linkUp = true;
+    stableSince = millis();
+    probeOutstanding = false;
+    lastProbe = millis() - PROBE_INTERVAL;  // first sample right away
+}
+
+void LinkMonitor::onConnectFailed(int state) {
+    switch (state) {
+        case MQTT_CONNECT_BAD_PROTOCOL:
+        case MQTT_CONNECT_BAD_CLIENT_ID:
+        case MQTT_CONNECT_BAD_CREDENTIALS:
+        case MQTT_CONNECT_UNAUTHORIZED:
+            // Retrying quickly cannot fix a refused configuration
+            reconnectDelay = REJECTED_BACKOFF / 2 + random(REJECTED_BACKOFF / 2 + 1);
+            lastAttempt = millis();
+            break;
+        case MQTT_CONNECT_UNAVAILABLE:
+            scheduleReconnect(BUSY_BACKOFF);
+            break;
+        default:
+            scheduleReconnect(MIN_BACKOFF);
+            break;
+    }
+    DEBUG_PRINT("[Link] Next reconnect in ms: ");
+    DEBUG_PRINTLN(reconnectDelay);
+}
+
+void LinkMonitor::onDisconnected(int state) {
+    linkUp = false;
+    reconnects++;
+    if (state == MQTT_CONNECTION_TIMEOUT) {
+        // Unanswered PINGREQ: give a lossy link more slack before the next drop
+        keepAlive = keepAlive + KEEPALIVE_STEP > MAX_KEEPALIVE ? MAX_KEEPALIVE : keepAlive + KEEPALIVE_STEP;
+    }
+    failures = 0;
+    scheduleReconnect(MIN_BACKOFF);
+}
+
+// Exponential backoff with jitter in [delay/2, delay], so a fleet that lost
+// the broker at the same moment does not reconnect in lockstep
+void LinkMonitor::scheduleReconnect(unsigned long base) {
+    unsigned long delayMs = base;
+    for (uint8_t i = 0; i < failures && delayMs < MAX_BACKOFF; i++) {
+        delayMs *= 2;
+    }
+    if (delayMs > MAX_BACKOFF) delayMs = MAX_BACKOFF;
+    if (failures < 16) failures++;
+
+    reconnectDelay = delayMs / 2 + random(delayMs / 2 + 1);
+    lastAttempt = millis();
+}
+
+// RTT percentiles are only reported when they move by more than 20% (plus
+// 10 ms), so jitter alone does not keep the heartbeat from backing off
+static bool rttMoved(uint16_t now, uint16_t reported) {
+    uint16_t diff = now > reported ? now - reported : reported - now;
+    return diff > reported / 5 + 10;
+}
+
+uint8_t LinkMonitor::addChangedStats(JsonDocument& doc) {
+    uint8_t added = 0;
+    uint16_t p50 = getRttPercentile(50);
+    uint16_t p90 = getRttPercentile(90);
+
+    if (sampleCount > 0 && (rttMoved(p50, reportedP50) || rttMoved(p90, reportedP90))) {
+        doc["rtt-p50"] = p50;
+        doc["rtt-p90"] = p90;
+        doc["rtt-max"] = getRttPercentile(100);
+        reportedP50 = p50;
+        reportedP90 = p90;
+        added++;
+    }
+    if (lostProbes != reportedLost) { doc["rtt-lost"] = lostProbes; reportedLost = lostProbes; added++; }
+    if (reconnects != reportedReconnects) { doc["reconnects"] = reconnects; reportedReconnects = reconnects; added++; }
+    if (keepAlive != reportedKeepAlive) { doc["keepalive"] = keepAlive; reportedKeepAlive = keepAlive; added++; }
+    return added;
+}
+
+// Forces every stat into the next report
+void LinkMonitor::resetReported() {
+    reportedP50 = 0xFFFF;
+    reportedP90 = 0xFFFF;
+    reportedLost = 0xFFFFFFFF;
+    reportedReconnects = 0xFFFFFFFF;
+    reportedKeepAlive = 0;
+}
@@ -0,0 +1,80 @@
+#ifndef LINKMONITOR_H
+#define LINKMONITOR_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+// Broker link quality: round-trip samples from probes echoed back by the
+// broker, reconnect backoff with jitter chosen by the failure reason, and a
+// keepalive that lengthens on flaky links and shrinks back once stable.
+// Sync owns the MQTT client and asks this class when to probe and reconnect.
+class LinkMonitor {
+public:
+    LinkMonitor();
+
+    // Probing; the returned id goes out as the probe payload
+    bool probeDue() const;
+    uint32_t startProbe();
+    void onEcho(const byte* payload, unsigned int length);
+    void loop();
+
+    // Session lifecycle, fed with PubSubClient's state(). The keepalive only
+    // grows at connect time; it may shrink mid-session, which just makes the
+    // client ping sooner than the broker requires
+    bool reconnectDue() const;
+    void onConnected();
+    void onConnectFailed(int state);
+    void onDisconnected(int state);
+    uint16_t getKeepAlive() const { return keepAlive; }
+
+    // Round trip percentile over the last RTT_WINDOW samples, in ms
+    uint16_t getRttPercentile(uint8_t percent) const;
+    uint8_t getSampleCount() const { return sampleCount; }
+    uint32_t getLostProbes() const { return lostProbes; }
+    uint32_t getReconnects() const { return reconnects; }
+    unsigned long getReconnectDelay() const { return reconnectDelay; }
+
+    // Adds the stats that moved since the last report; returns how many
+    uint8_t addChangedStats(JsonDocument& doc);
+    void resetReported();
+
+private:
+    static const uint8_t RTT_WINDOW = 32;
+    static const unsigned long PROBE_INTERVAL = 30000;
+    static const unsigned long PROBE_TIMEOUT = 5000;
+    static const uint16_t MIN_KEEPALIVE = 10;                   // seconds
+    static const uint16_t MAX_KEEPALIVE = 30;
+    static const uint16_t KEEPALIVE_STEP = 5;
+    static const unsigned long STABLE_SESSION = 30UL * 60000UL; // 30 min without a drop
+    static const unsigned long MIN_BACKOFF = 1000;              // network errors, doubled per failure
+    static const unsigned long BUSY_BACKOFF = 10000;            // broker unavailable
+    static const unsigned long MAX_BACKOFF = 60000;
+    static const unsigned long REJECTED_BACKOFF = 5UL * 60000UL; // credentials or client id refused
+
+    uint16_t samples[RTT_WINDOW];
+    uint8_t sampleNext;
+    uint8_t sampleCount;
+    uint32_t probeId;
+    unsigned long probeSentAt;
+    bool probeOutstanding;
+    unsigned long lastProbe;
+    uint32_t lostProbes;
+
+    uint16_t keepAlive;
+    bool linkUp;
+    unsigned long stableSince;
+    uint8_t failures;
+    unsigned long lastAttempt;
+    unsigned long reconnectDelay;
+    uint32_t reconnects;
+
+    uint16_t reportedP50;
+    uint16_t reportedP90;
+    uint32_t reportedLost;
+    uint32_t reportedReconnects;
+    uint16_t reportedKeepAlive;
+
+    void scheduleReconnect(unsigned long base);
+};
+
+#endif
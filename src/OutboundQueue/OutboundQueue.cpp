@@ -0,0 +1,94 @@
+#include "OutboundQueue.h"
+
+const uint8_t OutboundQueue::MAX_MESSAGES;
+const uint16_t OutboundQueue::POOL_SIZE;
+
+OutboundQueue::OutboundQueue()
+    : count(0), used(0), highWater(0), nextOrder(0), droppedCount(0), mergedCount(0) {
+    memset(messages, 0, sizeof(messages));
+}
+
+bool OutboundQueue::push(Priority priority, uint8_t topic, bool retained, bool merge, uint8_t tag,
+                         const uint8_t* payload, uint16_t length) {
+    if (length > POOL_SIZE) {
+        droppedCount++;
+        return false;
+    }
+
+    if (merge) {
+        for (uint8_t i = 0; i < count; i++) {
+            if (messages[i].priority == priority && messages[i].topic == topic) {
+                removeAt(i);
+                mergedCount++;
+                break;
+            }
+        }
+    }
+
+    // Evict from the back (least important, newest) while out of slots or
+    // bytes, but only messages no more important than the new one
+    while (count == MAX_MESSAGES || used + length > POOL_SIZE) {
+        int victim = -1;
+        for (int i = count - 1; i >= 0; i--) {
+            if (isDroppable(messages[i].priority) && messages[i].priority >= priority) {
+                victim = i;
+                break;
+            }
+        }
+        if (victim < 0) {
+            droppedCount++;
+            return false;
+        }
+        removeAt(victim);
+        droppedCount++;
+    }
+
+    uint8_t index = count;
+    while (index > 0 && messages[index - 1].priority > priority) {
+        messages[index] = messages[index - 1];
+        index--;
+    }
+
+    Message& message = messages[index];
+    message.priority = priority;
+    message.topic = topic;
+    message.tag = tag;
+    message.retained = retained;
+    message.offset = used;
+    message.length = length;
+    message.order = nextOrder++;
+    memcpy(pool + used, payload, length);
+    used += length;
+    count++;
+    if (used > highWater) highWater = used;
+    return true;
+}
+
+void OutboundQueue::pop() {
+    if (count > 0) removeAt(0);
+}
+
+void OutboundQueue::dropDroppable() {
+    for (int i = count - 1; i >= 0; i--) {
+        if (isDroppable(messages[i].priority)) {
+            removeAt(i);
+            droppedCount++;
+        }
+    }
+}
+
+// Closes the payload's gap in the pool so free space stays contiguous
+void OutboundQueue::removeAt(uint8_t index) {
+    uint16_t offset = messages[index].offset;
+    uint16_t length = messages[index].length;
+    memmove(pool + offset, pool + offset + length, used - offset - length);
+    used -= length;
+
+    for (uint8_t i = index; i + 1 < count; i++) {
+        messages[i] = messages[i + 1];
+    }
+    count--;
+    for (uint8_t i = 0; i < count; i++) {
+        if (messages[i].offset > offset) messages[i].offset -= length;
+    }
+}
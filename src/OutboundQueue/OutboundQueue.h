@@ -0,0 +1,65 @@
+#ifndef OUTBOUNDQUEUE_H
+#define OUTBOUNDQUEUE_H
+
+#include <Arduino.h>
+
+// Serialized MQTT messages waiting to be published, highest priority first
+// and FIFO within a priority. Payloads live in one fixed byte pool, so the
+// queue never allocates. Under pressure, state and heartbeat messages are
+// dropped to make room; acks and events are never evicted.
+class OutboundQueue {
+public:
+    enum Priority : uint8_t {
+        PRIORITY_ACK = 0,
+        PRIORITY_EVENT = 1,
+        PRIORITY_STATE = 2,
+        PRIORITY_HEARTBEAT = 3
+    };
+
+    struct Message {
+        uint8_t priority;
+        uint8_t topic;      // caller's topic id
+        uint8_t tag;        // caller data, returned with the message
+        bool retained;
+        uint16_t offset;
+        uint16_t length;
+        uint32_t order;
+    };
+
+    OutboundQueue();
+    // Copies the payload in. With merge, a queued message of the same
+    // priority and topic is replaced instead of kept. False if there is no
+    // room even after evicting droppable messages.
+    bool push(Priority priority, uint8_t topic, bool retained, bool merge, uint8_t tag,
+              const uint8_t* payload, uint16_t length);
+    const Message* front() const { return count > 0 ? &messages[0] : nullptr; }
+    const uint8_t* payloadOf(const Message& message) const { return pool + message.offset; }
+    void pop();
+    // Drops queued state and heartbeats, which are stale after a reconnect
+    void dropDroppable();
+
+    bool isEmpty() const { return count == 0; }
+    uint8_t getCount() const { return count; }
+    uint16_t getBytesUsed() const { return used; }
+    uint16_t getHighWater() const { return highWater; }
+    uint32_t getDroppedCount() const { return droppedCount; }
+    uint32_t getMergedCount() const { return mergedCount; }
+
+    static const uint8_t MAX_MESSAGES = 12;
+    static const uint16_t POOL_SIZE = 2048;
+
+private:
+    Message messages[MAX_MESSAGES];  // sorted by (priority, order)
+    uint8_t pool[POOL_SIZE];
+    uint8_t count;
+    uint16_t used;
+    uint16_t highWater;
+    uint32_t nextOrder;
+    uint32_t droppedCount;
+    uint32_t mergedCount;
+
+    static bool isDroppable(uint8_t priority) { return priority >= PRIORITY_STATE; }
+    void removeAt(uint8_t index);
+};
+
+#endif
@@ -0,0 +1,114 @@
+#include "PinThrottle.h"
+#include "../globals.h"
+
+PinThrottle::PinThrottle() : rejectedCount(0), lockoutCount(0) {
+    memset(clients, 0, sizeof(clients));
+}
+
+unsigned long PinThrottle::acquire(uint32_t ip) {
+    Client& client = lookup(ip);
+    unsigned long now = millis();
+    client.lastSeen = now;
+
+    if (client.lockedUntil != 0) {
+        if ((long)(client.lockedUntil - now) > 0) {
+            rejectedCount++;
+            return client.lockedUntil - now;
+        }
+        client.lockedUntil = 0;
+    }
+
+    unsigned long refills = (now - client.lastRefill) / REFILL_INTERVAL;
+    if (refills > 0) {
+        unsigned long tokens = client.tokens + refills;
+        client.tokens = tokens > BUCKET_SIZE ? BUCKET_SIZE : tokens;
+        client.lastRefill += refills * REFILL_INTERVAL;
+    }
+
+    if (client.tokens == 0) {
+        rejectedCount++;
+        return REFILL_INTERVAL - (now - client.lastRefill);
+    }
+
+    client.tokens--;
+    return 0;
+}
+
+void PinThrottle::recordFailure(uint32_t ip) {
+    Client& client = lookup(ip);
+    if (++client.failures < FAILURES_BEFORE_LOCKOUT) return;
+
+    unsigned long duration = BASE_LOCKOUT << (client.lockouts > 5 ? 5 : client.lockouts);
+    if (duration > MAX_LOCKOUT) duration = MAX_LOCKOUT;
+    // lockedUntil == 0 means "not locked"
+    client.lockedUntil = (millis() + duration) | 1;
+    client.failures = 0;
+    if (client.lockouts < 255) client.lockouts++;
+    lockoutCount++;
+
+    DEBUG_PRINT("[PinThrottle] Client locked out for ");
+    DEBUG_PRINT(duration / 1000);
+    DEBUG_PRINTLN(" s");
+}
+
+void PinThrottle::recordSuccess(uint32_t ip) {
+    Client* client = find(ip);
+    if (!client) return;
+    client->failures = 0;
+    client->lockouts = 0;
+}
+
+uint8_t PinThrottle::getActiveLockouts() const {
+    unsigned long now = millis();
+    uint8_t count = 0;
+    for (const Client& client : clients) {
+        if (client.ip != 0 && client.lockedUntil != 0 && (long)(client.lockedUntil - now) > 0) {
+            count++;
+        }
+    }
+    return count;
+}
+
+PinThrottle::Client* PinThrottle::find(uint32_t ip) {
+    for (Client& client : clients) {
+        if (client.ip == ip) return &client;
+    }
+    return nullptr;
+}
+
+// Finds the client's slot, recycling the least recently seen unlocked slot
+// (or, if every slot is locked, the oldest one) for new clients.
+PinThrottle::Client& PinThrottle::lookup(uint32_t ip) {
+    Client* client = find(ip);
+    unsigned long now = millis();
+    if (client) {
+        if (client->lockedUntil == 0 && now - client->lastSeen > FORGET_AFTER) {
+            client->failures = 0;
+            client->lockouts = 0;
+        }
+        return *client;
+    }
+
+    Client* victim = &clients[0];
+    for (Client& candidate : clients) {
+        if (candidate.ip == 0) {
+            victim = &candidate;
+            break;
+        }
+        bool candidateLocked = candidate.lockedUntil != 0 && (long)(candidate.lockedUntil - now) > 0;
+        bool victimLocked = victim->lockedUntil != 0 && (long)(victim->lockedUntil - now) > 0;
+        if ((victimLocked && !candidateLocked)
+            || (victimLocked == candidateLocked && now - candidate.lastSeen > now - victim->lastSeen)) {
+            victim = &candidate;
+        }
+    }
+
+    victim->ip = ip;
+    victim->tokens = BUCKET_SIZE;
+    victim->failures = 0;
+    victim->lockouts = 0;
+    victim->lastRefill = now;
+    victim->lastSeen = now;
+    victim->lockedUntil = 0;
+    return *victim;
+}
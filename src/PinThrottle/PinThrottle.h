@@ -0,0 +1,49 @@
+#ifndef PINTHROTTLE_H
+#define PINTHROTTLE_H
+
+#include <Arduino.h>
+
+// Per-client brute-force protection for PIN attempts. Each client IP gets a
+// small token bucket; repeated failures lock the client out for a period that
+// doubles on every lockout. Never blocks: callers reject with the returned
+// retry delay instead of sleeping.
+class PinThrottle {
+public:
+    PinThrottle();
+    // 0 if the attempt may proceed (consumes a token), otherwise ms until retry
+    unsigned long acquire(uint32_t ip);
+    void recordFailure(uint32_t ip);
+    void recordSuccess(uint32_t ip);
+
+    uint32_t getRejectedCount() const { return rejectedCount; }
+    uint32_t getLockoutCount() const { return lockoutCount; }
+    uint8_t getActiveLockouts() const;
+
+private:
+    static const uint8_t MAX_CLIENTS = 8;
+    static const uint8_t BUCKET_SIZE = 3;
+    static const unsigned long REFILL_INTERVAL = 3000;        // one attempt per 3 s sustained
+    static const uint8_t FAILURES_BEFORE_LOCKOUT = 5;
+    static const unsigned long BASE_LOCKOUT = 30000;          // 30 s, doubled per lockout
+    static const unsigned long MAX_LOCKOUT = 15UL * 60000UL;  // 15 min
+    static const unsigned long FORGET_AFTER = 60UL * 60000UL; // reset penalty after 1 h quiet
+
+    struct Client {
+        uint32_t ip;
+        uint8_t tokens;
+        uint8_t failures;
+        uint8_t lockouts;
+        unsigned long lastRefill;
+        unsigned long lastSeen;
+        unsigned long lockedUntil;
+    };
+
+    Client clients[MAX_CLIENTS];
+    uint32_t rejectedCount;
+    uint32_t lockoutCount;
+
+    Client& lookup(uint32_t ip);
+    Client* find(uint32_t ip);
+};
+
+#endif
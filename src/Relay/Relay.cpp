@@ -0,0 +1,123 @@
+#include "Relay.h"
+#include "../globals.h"
+
+Relay::Relay()
+    : onEdge(nullptr), onAck(nullptr), queueCount(0), state(IDLE), stateSince(0), lastLoopMicros(0),
+      maxLoopGapMicros(0), pulseCount(0), coalescedCount(0) {
+}
+
+void Relay::init(EdgeFn onEdge, AckFn onAck) {
+    this->onEdge = onEdge;
+    this->onAck = onAck;
+    pinMode(deviceConfig.getPulsePin(), OUTPUT);
+    write(false);
+}
+
+void Relay::write(bool energized) {
+    bool level = energized != deviceConfig.getPulseInverted();
+    digitalWrite(deviceConfig.getPulsePin(), level ? HIGH : LOW);
+}
+
+const int32_t Relay::TRANSIT_UNKNOWN;
+
+Relay::RequestResult Relay::request(const char* action, const char* commandId, const Trace* trace) {
+    if (queueCount == QUEUE_SIZE) {
+        DEBUG_PRINTLN("[Relay] Queue full, rejecting request");
+        return REJECTED;
+    }
+
+    // While energized, a new request joins the current pulse: insert it right
+    // after the active request and any requests already coalesced into it.
+    bool coalesce = state == ON;
+    uint8_t slot = queueCount;
+    if (coalesce) {
+        slot = 1;
+        while (slot < queueCount && queue[slot].coalesced) slot++;
+        for (uint8_t i = queueCount; i > slot; i--) {
+            queue[i] = queue[i - 1];
+        }
+    }
+
+    Request& entry = queue[slot];
+    strncpy(entry.action, action, sizeof(entry.action) - 1);
+    entry.action[sizeof(entry.action) - 1] = '\0';
+    strncpy(entry.commandId, commandId ? commandId : "", sizeof(entry.commandId) - 1);
+    entry.commandId[sizeof(entry.commandId) - 1] = '\0';
+    entry.remote = commandId != nullptr;
+    entry.coalesced = coalesce;
+    if (trace) {
+        entry.trace = *trace;
+    } else {
+        memset(&entry.trace, 0, sizeof(entry.trace));
+        entry.trace.transitMs = TRANSIT_UNKNOWN;
+    }
+    // A coalesced request finds the relay already on: no dispatch delay
+    entry.trace.relayOn = coalesce ? entry.trace.parsed : 0;
+    queueCount++;
+
+    if (coalesce) {
+        coalescedCount++;
+        DEBUG_PRINTLN("[Relay] Request coalesced into active pulse");
+        return COALESCED;
+    }
+    return QUEUED;
+}
+
+void Relay::loop() {
+    unsigned long nowMicros = micros();
+    if (state != IDLE && lastLoopMicros != 0) {
+        unsigned long gap = nowMicros - lastLoopMicros;
+        if (gap > maxLoopGapMicros) maxLoopGapMicros = gap;
+    }
+    lastLoopMicros = state != IDLE ? nowMicros : 0;
+
+    unsigned long now = millis();
+    switch (state) {
+        case IDLE:
+            if (queueCount == 0) return;
+            DEBUG_PRINT("[Relay] Pulse on pin: ");
+            DEBUG_PRINTLN(deviceConfig.getPulsePin());
+            write(true);
+            queue[0].trace.relayOn = micros();
+            if (onEdge) onEdge("on", queue[0].action, queue[0].remote);
+            state = ON;
+            stateSince = now;
+            lastLoopMicros = micros();
+            break;
+
+        case ON:
+            if (now - stateSince < deviceConfig.getPulseWidth()) return;
+            write(false);
+            pulseCount++;
+            if (onEdge) onEdge("off", queue[0].action, queue[0].remote);
+            completePulse();
+            state = GAP;
+            stateSince = now;
+            break;
+
+        case GAP:
+            if (now - stateSince < MIN_GAP) return;
+            state = IDLE;
+            break;
+    }
+}
+
+// Drops the finished request and those coalesced into it, acking MQTT ones
+void Relay::completePulse() {
+    uint8_t done = 1;
+    while (done < queueCount && queue[done].coalesced) done++;
+
+    uint32_t offMicros = micros();
+    for (uint8_t i = 0; i < done; i++) {
+        if (queue[i].remote && onAck) {
+            queue[i].trace.relayOff = offMicros;
+            onAck(queue[i].action, queue[i].commandId, &queue[i].trace);
+        }
+    }
+
+    for (uint8_t i = done; i < queueCount; i++) {
+        queue[i - done] = queue[i];
+    }
+    queueCount -= done;
+    DEBUG_PRINTLN("[Relay] Relay pulse completed");
+}
@@ -0,0 +1,73 @@
+#ifndef RELAY_H
+#define RELAY_H
+
+#include <Arduino.h>
+
+// Non-blocking relay driver. Pulses are scheduled against millis() and
+// advanced from loop(); requests queue up behind the active pulse, and
+// requests arriving while the relay is energized ride along with it.
+class Relay {
+public:
+    // Microsecond timestamps of an MQTT command's way through the device,
+    // returned in its ack
+    struct Trace {
+        uint32_t arrived;    // handed over by PubSubClient
+        uint32_t parsed;
+        uint32_t relayOn;
+        uint32_t relayOff;
+        int32_t transitMs;   // backend timestamp_ms to arrival, TRANSIT_UNKNOWN if not sent
+    };
+    static const int32_t TRANSIT_UNKNOWN = INT32_MIN;
+
+    enum RequestResult {
+        QUEUED,
+        COALESCED,   // joined the pulse in progress, acked when it ends
+        REJECTED     // queue full
+    };
+
+    // Called on each edge with the request that owns the pulse
+    typedef void (*EdgeFn)(const char* state, const char* action, bool remote);
+    // Called once per MQTT request after the off edge of its pulse
+    typedef void (*AckFn)(const char* action, const char* commandId, const Trace* trace);
+
+    Relay();
+    void init(EdgeFn onEdge, AckFn onAck);
+    void loop();
+    // commandId is null for local (web) requests; MQTT requests are acked
+    // through onAck once their pulse has actually finished.
+    RequestResult request(const char* action, const char* commandId, const Trace* trace = nullptr);
+    bool isActive() const { return state != IDLE; }
+    unsigned long getMaxLoopGapMicros() const { return maxLoopGapMicros; }
+    uint32_t getPulseCount() const { return pulseCount; }
+    uint32_t getCoalescedCount() const { return coalescedCount; }
+
+private:
+    static const uint8_t QUEUE_SIZE = 6;
+    static const unsigned long MIN_GAP = 500;   // relay off time between queued pulses
+
+    enum State { IDLE, ON, GAP };
+
+    struct Request {
+        char action[16];
+        char commandId[40];
+        bool remote;
+        bool coalesced;   // belongs to the pulse of the request before it
+        Trace trace;
+    };
+
+    EdgeFn onEdge;
+    AckFn onAck;
+    Request queue[QUEUE_SIZE];
+    uint8_t queueCount;
+    State state;
+    unsigned long stateSince;
+    unsigned long lastLoopMicros;
+    unsigned long maxLoopGapMicros;
+    uint32_t pulseCount;
+    uint32_t coalescedCount;
+
+    void write(bool energized);
+    void completePulse();
+};
+
+#endif
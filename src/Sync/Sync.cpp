@@ -9,6 +9,10 @@
 #include "../AccessManager/AccessManager.h"
 
 static const unsigned long MAX_COMMAND_AGE_SEC = 5;
+static const uint8_t EVENT_BATCH_SIZE = 4;              // keeps a batch under the 512-byte MQTT buffer
+static const unsigned long EVENT_DRAIN_INTERVAL = 200;  // one batch per interval leaves room for live traffic
+
+const uint16_t Sync::REACTION_BOUNDS_MS[Sync::REACTION_BUCKETS - 1] = {5, 10, 25, 50, 100, 250, 1000};
 
 static Sync* s_syncInstance = nullptr;
 
@@ -19,9 +23,20 @@ static void mqttCallbackStatic(char* topic, byte* payload, unsigned int length)
 }
 
 Sync::Sync() : mqttClient(wifiClient) {
-  lastReconnectAttempt = 0;
   lastSuccessfulSync = 0;
   lastHeartbeat = 0;
+  heartbeatSeq = 0;
+  heartbeatInterval = HEARTBEAT_INITIAL_INTERVAL;
+  sensorChangedSinceHeartbeat = false;
+  bootReported = false;
+  reactionHistogramChanged = true;
+  statusBytes = 0;
+  pingTimeouts = 0;
+  memset(&lastReported, 0, sizeof(lastReported));
+  lastEventDrain = 0;
+  seenCommandsNext = 0;
+  duplicateCommands = 0;
+  memset(seenCommands, 0, sizeof(seenCommands));
   connected = false;
   deviceId = String(ESP.getChipId(), HEX);
   clientId = "esp-" + deviceId;
@@ -31,6 +46,24 @@ Sync::Sync() : mqttClient(wifiClient) {
   topicStatus = "device/" + deviceId + "/status";
   topicEvent = "device/" + deviceId + "/event";
   topicAccessCodesAck = "device/" + deviceId + "/access-codes/ack";
+  topicEcho = "device/" + deviceId + "/echo";
+  topicPrefixLen = topicCommand.length() - strlen("command");
+  inboundMessages = 0;
+  inboundHeapDelta = 0;
+  outboundMessages = 0;
+  outboundHeapDelta = 0;
+  outboundRetries = 0;
+  outboundAbandoned = 0;
+  headOrder = 0;
+  headFailures = 0;
+  eventsInFlight = 0;
+  memset(reactionHistogram, 0, sizeof(reactionHistogram));
+  reactionHistogramChanged = false;
+  memset(&inboundTrace, 0, sizeof(inboundTrace));
+  tlsMfln = -1;
+  lastConnectMillis = 0;
+  lastConnectHeap = 0;
+  memset(encodingStats, 0, sizeof(encodingStats));
 
   s_syncInstance = this;
   mqttClient.setCallback(mqttCallbackStatic);
@@ -41,12 +74,25 @@ Sync::Sync() : mqttClient(wifiClient) {
   DEBUG_PRINTLN("MQTT topics configured");
 }
 
+void Sync::begin() {
+  eventJournal.begin();
+}
+
 void Sync::handle() {
   if (!mqttClient.connected()) {
+    if (connected) {
+      // PubSubClient drops the session itself when a PINGREQ goes
+      // unanswered for a keepalive period
+      if (mqttClient.state() == MQTT_CONNECTION_TIMEOUT) {
+        pingTimeouts++;
+      }
+      DEBUG_PRINT("[MQTT] Connection lost, state=");
+      DEBUG_PRINTLN(mqttClient.state());
+      linkMonitor.onDisconnected(mqttClient.state());
+    }
     connected = false;
     if (WiFi.status() == WL_CONNECTED && strlen(deviceConfig.getMqttHost()) > 0) {
-      if (millis() - lastReconnectAttempt > 5000) {
-        lastReconnectAttempt = millis();
+      if (linkMonitor.reconnectDue()) {
         reconnect();
       }
     }
@@ -54,19 +100,24 @@ void Sync::handle() {
     mqttClient.loop();
     connected = true;
 
-    // Heartbeat: send status periodically (every 60s)
-    if (millis() - lastHeartbeat > 60000) {
-      sendDeviceStatus();
+    linkMonitor.loop();
+    mqttClient.setKeepAlive(linkMonitor.getKeepAlive());
+    if (linkMonitor.probeDue()) {
+      // The broker echoes the probe back on our own subscription
+      char probe[12];
+      snprintf(probe, sizeof(probe), "%lu", (unsigned long)linkMonitor.startProbe());
+      mqttClient.publish(topicEcho.c_str(), probe);
+    }
+
+    drainEvents();
+
+    if (millis() - lastHeartbeat > heartbeatInterval) {
+      sendHeartbeat();
       lastHeartbeat = millis();
       lastSuccessfulSync = millis();
     }
 
-    // Connection timeout (5 min)
-    if (millis() - lastSuccessfulSync > 300000) {
-      DEBUG_PRINTLN("[MQTT] Connection timeout, will reconnect...");
-      mqttClient.disconnect();
-      connected = false;
-    }
+    drainOutbound(OUTBOUND_DRAIN_BUDGET);
   }
 }
 
@@ -84,55 +135,170 @@ void Sync::connect() {
 
 bool Sync::reconnect() {
   mqttClient.setServer(deviceConfig.getMqttHost(), deviceConfig.getMqttPort());
-  if (strlen(deviceConfig.getMqttUser()) > 0) {
-    mqttClient.connect(clientId.c_str(), deviceConfig.getMqttUser(), deviceConfig.getMqttPassword());
+  if (deviceConfig.getMqttTls()) {
+    if (!configureTls()) {
+      linkMonitor.onConnectFailed(MQTT_CONNECT_FAILED);
+      return false;
+    }
+    mqttClient.setClient(secureClient);
   } else {
-    mqttClient.connect(clientId.c_str());
+    mqttClient.setClient(wifiClient);
+  }
+
+  // Last Will: when the keepalive lapses the broker publishes a retained
+  // offline state over the retained online descriptor, within seconds.
+  // Always JSON whatever the encoding: PubSubClient takes the will as a C
+  // string, and MessagePack may contain 0x00 bytes that would truncate it.
+  JsonDocument& will = outbound();
+  will["chip-id"] = deviceId.c_str();
+  will["state"] = "offline";
+  char willMessage[64];
+  serializeJson(will, willMessage, sizeof(willMessage));
+
+  mqttClient.setKeepAlive(linkMonitor.getKeepAlive());
+  bool hasUser = strlen(deviceConfig.getMqttUser()) > 0;
+  uint32_t heapBefore = ESP.getFreeHeap();
+  unsigned long connectStart = millis();
+  mqttClient.connect(clientId.c_str(),
+                     hasUser ? deviceConfig.getMqttUser() : nullptr,
+                     hasUser ? deviceConfig.getMqttPassword() : nullptr,
+                     topicStatus.c_str(), 1, true, willMessage);
+  lastConnectMillis = millis() - connectStart;
+  uint32_t heapAfter = ESP.getFreeHeap();
+  lastConnectHeap = heapBefore > heapAfter ? heapBefore - heapAfter : 0;
+
+  if (deviceConfig.getMqttTls()) {
+    // A probe that said no is only trusted once the broker proved reachable;
+    // after a failed connect, whatever was cached is probed again
+    if (!mqttClient.connected()) {
+      tlsMfln = -1;
+    } else if (tlsMfln < 0) {
+      tlsMfln = 0;
+    }
   }
 
   if (mqttClient.connected()) {
     DEBUG_PRINTLN("[MQTT] Connected to broker");
+    bootProfile.mark(BootProfile::PHASE_MQTT);
+    linkMonitor.onConnected();
+    linkMonitor.resetReported();
+    // Acks and events survive the reconnect; state is about to be resent
+    outboundQueue.dropDroppable();
     subscribeToTopics();
-    sendDeviceStatus();
+    sendDeviceDescriptor();
     lastSuccessfulSync = millis();
     lastHeartbeat = millis();
     return true;
   }
   DEBUG_PRINT("[MQTT] Connection failed, rc=");
   DEBUG_PRINTLN(mqttClient.state());
+  linkMonitor.onConnectFailed(mqttClient.state());
   return false;
 }
 
+// Returns false when the connection should not be attempted: the broker
+// needs full-size TLS buffers and the heap cannot hold them
+bool Sync::configureTls() {
+  const char* fingerprint = deviceConfig.getMqttFingerprint();
+  if (strlen(fingerprint) > 0) {
+    secureClient.setFingerprint(fingerprint);
+  } else {
+    DEBUG_PRINTLN("[MQTT] TLS without a fingerprint, broker identity not verified");
+    secureClient.setInsecure();
+  }
+  secureClient.setSession(&tlsSession);
+
+  // Probing costs a connection of its own, so a known answer is reused.
+  // false also means the broker could not be reached, so it is not cached
+  // here: reconnect() settles it once the connection itself succeeds.
+  bool mfln = tlsMfln == 1;
+  if (tlsMfln < 0) {
+    mfln = secureClient.probeMaxFragmentLength(deviceConfig.getMqttHost(), deviceConfig.getMqttPort(), TLS_FRAGMENT);
+    if (mfln) tlsMfln = 1;
+    DEBUG_PRINT("[MQTT] Broker max fragment length support: ");
+    DEBUG_PRINTLN(mfln ? 1 : 0);
+  }
+  if (mfln) {
+    secureClient.setBufferSizes(TLS_FRAGMENT, TLS_FRAGMENT);
+    return true;
+  }
+
+  secureClient.setBufferSizes(TLS_FULL_RECORD, TLS_FRAGMENT);
+  uint32_t freeHeap = ESP.getFreeHeap();
+  uint32_t maxBlock = ESP.getMaxFreeBlockSize();
+  if (freeHeap < TLS_FULL_HEAP || maxBlock < TLS_FULL_BLOCK) {
+    DEBUG_PRINT("[MQTT] TLS connect skipped, broker without max fragment length needs ~17 KB; free heap: ");
+    DEBUG_PRINT(freeHeap);
+    DEBUG_PRINT(", largest block: ");
+    DEBUG_PRINTLN(maxBlock);
+    return false;
+  }
+  return true;
+}
+
 void Sync::subscribeToTopics() {
-  mqttClient.subscribe(topicCommand.c_str());
-  mqttClient.subscribe(topicAccessCodesSync.c_str());
+  // QoS1: at-least-once delivery; command_id dedupe and the access-code
+  // sequence numbers make redeliveries harmless
+  mqttClient.subscribe(topicCommand.c_str(), 1);
+  mqttClient.subscribe(topicAccessCodesSync.c_str(), 1);
+  mqttClient.subscribe(topicEcho.c_str(), 0);
   DEBUG_PRINTLN("[MQTT] Subscribed to command and access-codes/sync topics");
 }
 
+// Inbound messages are parsed in place (ArduinoJson zero-copy mode) straight
+// from PubSubClient's buffer into a preallocated document, and routed by topic
+// suffix (InboundParser), so parsing and routing allocate nothing (handlers
+// still may, e.g. LittleFS file handles for access codes). Publishing reuses
+// that same buffer: handlers must be done reading `data` before they publish.
+// JSON and MessagePack are both accepted whatever the configured encoding,
+// so the backend can switch encodings without a reconfiguration round trip.
 void Sync::mqttCallback(char* topic, byte* payload, unsigned int length) {
-  if (length >= 512) return;
-  char buffer[512];
-  memcpy(buffer, payload, length);
-  buffer[length] = '\0';
+  // Net heap kept across the message, whichever way handling ends: a leak
+  // grows the total, memory released again later brings it back down
+  int32_t heapBefore = ESP.getFreeHeap();
+  handleInbound(topic, payload, length);
+  inboundHeapDelta += heapBefore - (int32_t)ESP.getFreeHeap();
+}
+
+void Sync::handleInbound(char* topic, byte* payload, unsigned int length) {
+  inboundTrace.arrived = micros();
+  uint64_t arrivedUnixMs = systemClock.getUnixMillis();
+  inboundMessages++;
 
   DEBUG_PRINT("[MQTT] Message on ");
   DEBUG_PRINT(topic);
-  DEBUG_PRINT(": ");
-  DEBUG_PRINTLN((char*)buffer);
+  DEBUG_PRINT(", bytes: ");
+  DEBUG_PRINTLN(length);
 
-  DynamicJsonDocument doc(512);
-  DeserializationError error = deserializeJson(doc, buffer);
+  InboundParser::Route route = InboundParser::route(topic, topicCommand.c_str(), topicPrefixLen);
+  if (route == InboundParser::ROUTE_ECHO) {
+    linkMonitor.onEcho(payload, length);
+    return;
+  }
+  if (route == InboundParser::ROUTE_IGNORED) return;
+
+  bool msgPack = InboundParser::isMsgPack(payload, length);
+  unsigned long parseStart = micros();
+  DeserializationError error = InboundParser::parse(inboundDoc, route, msgPack, payload, length);
+  EncodingStats& stats = encodingStats[msgPack ? ENCODING_MSGPACK : ENCODING_JSON];
+  stats.inMessages++;
+  stats.inBytes += length;
+  inboundTrace.parsed = micros();
+  stats.inParseMicros += inboundTrace.parsed - parseStart;
   if (error) {
-    DEBUG_PRINTLN("[MQTT] JSON parse error");
+    DEBUG_PRINTLN(msgPack ? "[MQTT] MessagePack parse error" : "[MQTT] JSON parse error");
     return;
   }
 
-  JsonObject data = doc.as<JsonObject>();
-  String topicStr = String(topic);
-
-  if (topicStr == topicCommand) {
+  JsonObject data = inboundDoc.as<JsonObject>();
+  // Optional backend send time in unix ms; both clocks are NTP-synced
+  uint64_t sentUnixMs = data["timestamp_ms"] | 0ULL;
+  inboundTrace.transitMs = sentUnixMs != 0 && arrivedUnixMs != 0
+    ? (int32_t)(int64_t)(arrivedUnixMs - sentUnixMs)
+    : Relay::TRANSIT_UNKNOWN;
+  if (route == InboundParser::ROUTE_COMMAND) {
     handleCommand(data);
-  } else if (topicStr == topicAccessCodesSync) {
+  } else {
     handleAccessCodesSync(data);
   }
 }
@@ -142,10 +308,17 @@ void Sync::handleCommand(JsonObject data) {
   if (!action) return;
 
   const char* cmdId = data["command_id"].as<const char*>();
-  String commandId = (cmdId && strlen(cmdId) > 0) ? String(cmdId) : "local";
+  const char* commandId = (cmdId && strlen(cmdId) > 0) ? cmdId : "local";
 
   lastSuccessfulSync = millis();
 
+  if (isDuplicateCommand(cmdId)) {
+    DEBUG_PRINTLN("[MQTT] Duplicate command ignored");
+    duplicateCommands++;
+    sendCommandAck(action, 255, commandId, "-duplicate");
+    return;
+  }
+
   if (strcmp(action, "pulse") == 0 || strcmp(action, "toggle") == 0 || strcmp(action, "push_button") == 0) {
     // Validate command age (ignore stale commands > 5 seconds)
     unsigned long msgTimestamp = data["timestamp"] | 0UL;
@@ -153,125 +326,484 @@ void Sync::handleCommand(JsonObject data) {
       unsigned long now = systemClock.getUnixTime();
       if (now == 0) {
         DEBUG_PRINTLN("[MQTT] Command rejected: clock not synced, cannot validate age");
-        sendCommandAck(String(action) + "-rejected", 255, commandId.c_str());
+        sendCommandAck(action, 255, commandId, "-rejected");
         return;
       }
       if (now >= msgTimestamp && (now - msgTimestamp) > MAX_COMMAND_AGE_SEC) {
         DEBUG_PRINTLN("[MQTT] Command rejected: too old (stale)");
-        sendCommandAck(String(action) + "-rejected-stale", 255, commandId.c_str());
+        sendCommandAck(action, 255, commandId, "-rejected-stale");
         return;
       }
     }
-    executeRelay(action, commandId.c_str());
+    // A command turned away by a full relay queue did not run, so its
+    // redelivery must not be answered as a duplicate
+    if (executeRelay(action, commandId)) {
+      rememberCommand(cmdId);
+    }
   } else if (strcmp(action, "update_firmware") == 0) {
-    updateFirmware(commandId.c_str());
+    rememberCommand(cmdId);
+    updateFirmware(commandId);
+  } else if (strcmp(action, "status") == 0) {
+    // Lets the backend recover the full descriptor after a heartbeat seq gap
+    sendDeviceDescriptor();
+    sendCommandAck(action, 255, commandId);
+  } else if (strcmp(action, "set_encoding") == 0) {
+    // Negotiation: the backend switches the device once it knows it can
+    // decode MessagePack; the ack already goes out in the new encoding
+    const char* encoding = data["encoding"] | "";
+    bool msgPack = strcmp(encoding, "msgpack") == 0;
+    if (!msgPack && strcmp(encoding, "json") != 0) {
+      sendCommandAck(action, 255, commandId, "-rejected");
+      return;
+    }
+    rememberCommand(cmdId);
+    if (msgPack != deviceConfig.getMqttMsgPack()) {
+      deviceConfig.setMqttMsgPack(msgPack);
+      deviceConfig.saveConfig();
+    }
+    sendCommandAck(action, 255, commandId);
   } else {
-    sendCommandAck(String(action), 255, commandId.c_str());
+    sendCommandAck(action, 255, commandId);
   }
 }
 
 void Sync::handleAccessCodesSync(JsonObject data) {
   const char* action = data["action"].as<const char*>();
-  if (!action || strcmp(action, "sync_access_codes") != 0) return;
+  if (!action) return;
+  if (strcmp(action, "access_code_delta") == 0) {
+    handleAccessCodeDelta(data);
+    return;
+  }
+  if (strcmp(action, "sync_access_codes") != 0) return;
+  if (data.containsKey("parts")) {
+    handleAccessCodesPage(data);
+    return;
+  }
 
   lastSuccessfulSync = millis();
 
+  bool complete = true;
   JsonArray accessCodes = data["access_codes"].as<JsonArray>();
   if (!accessCodes.isNull()) {
-    accessManager.syncFromBackend(accessCodes);
+    complete = accessManager.syncFromBackend(accessCodes, data["seq"] | 0UL);
   }
 
   // Send ACK
-  DynamicJsonDocument ackDoc(128);
+  JsonDocument& ackDoc = outbound();
   ackDoc["command_id"] = data["command_id"];
   ackDoc["action"] = "sync_access_codes";
-  String ackMsg;
-  serializeJson(ackDoc, ackMsg);
-  mqttClient.publish(topicAccessCodesAck.c_str(), ackMsg.c_str());
+  ackDoc["status"] = complete ? "ok" : "table_full";
+  ackDoc["stored"] = accessManager.getPinCount();
+  ackDoc["capacity"] = AccessManager::MAX_PINS;
+  ackDoc["seq"] = accessManager.getSyncSeq();
+  queueOutbound(OutboundQueue::PRIORITY_ACK, OUT_ACCESS_CODES_ACK);
+}
+
+void Sync::handleAccessCodesPage(JsonObject data) {
+  lastSuccessfulSync = millis();
+
+  uint16_t part = data["part"] | 0;
+  AccessManager::StageResult result = accessManager.stageSyncPage(
+    data["batch"].as<const char*>(), part, data["parts"] | 0, data["seq"] | 0UL,
+    data["access_codes"].as<JsonArray>());
+
+  const char* status;
+  switch (result) {
+    case AccessManager::STAGE_PENDING:             status = "staged"; break;
+    case AccessManager::STAGE_COMMITTED:           status = "ok"; break;
+    case AccessManager::STAGE_COMMITTED_TRUNCATED: status = "table_full"; break;
+    case AccessManager::STAGE_DUPLICATE:           status = "duplicate"; break;
+    case AccessManager::STAGE_OUT_OF_ORDER:        status = "resync_required"; break;
+    default:                                       status = "invalid"; break;
+  }
+
+  JsonDocument& ackDoc = outbound();
+  ackDoc["command_id"] = data["command_id"];
+  ackDoc["action"] = "sync_access_codes";
+  ackDoc["batch"] = data["batch"];
+  ackDoc["part"] = part;
+  ackDoc["status"] = status;
+  if (result == AccessManager::STAGE_COMMITTED || result == AccessManager::STAGE_COMMITTED_TRUNCATED) {
+    ackDoc["stored"] = accessManager.getPinCount();
+    ackDoc["capacity"] = AccessManager::MAX_PINS;
+    ackDoc["seq"] = accessManager.getSyncSeq();
+  }
+  queueOutbound(OutboundQueue::PRIORITY_ACK, OUT_ACCESS_CODES_ACK);
+}
+
+void Sync::handleAccessCodeDelta(JsonObject data) {
+  lastSuccessfulSync = millis();
+
+  AccessManager::DeltaResult result = accessManager.applyDelta(data);
+  const char* status;
+  switch (result) {
+    case AccessManager::DELTA_APPLIED:    status = "ok"; break;
+    case AccessManager::DELTA_DUPLICATE:  status = "duplicate"; break;
+    case AccessManager::DELTA_GAP:        status = "resync_required"; break;
+    case AccessManager::DELTA_TABLE_FULL: status = "table_full"; break;
+    default:                              status = "invalid"; break;
+  }
+
+  // On a gap the backend answers the resync_required ack with a full sync
+  JsonDocument& ackDoc = outbound();
+  ackDoc["command_id"] = data["command_id"];
+  ackDoc["action"] = "access_code_delta";
+  ackDoc["seq"] = data["seq"];
+  ackDoc["status"] = status;
+  ackDoc["last_seq"] = accessManager.getSyncSeq();
+  queueOutbound(OutboundQueue::PRIORITY_ACK, OUT_ACCESS_CODES_ACK);
+}
+
+// Every message is built in the shared outboundDoc, serialized into
+// outboundBuffer and copied into outboundQueue, all preallocated, so building
+// and queueing a message does not use the heap. The keys are the same in both
+// encodings; MessagePack only drops the JSON punctuation and encodes numbers
+// in binary.
+JsonDocument& Sync::outbound() {
+  outboundDoc.clear();
+  return outboundDoc;
+}
+
+// Signed net heap kept by serializing and queueing, on every outcome,
+// the same accounting as mqttCallback
+bool Sync::queueOutbound(OutboundQueue::Priority priority, OutboundTopic topic, bool retained, bool merge, uint8_t tag) {
+  int32_t heapBefore = ESP.getFreeHeap();
+  bool queued = enqueueOutbound(priority, topic, retained, merge, tag);
+  outboundHeapDelta += heapBefore - (int32_t)ESP.getFreeHeap();
+  return queued;
 }
 
-void Sync::executeRelay(const char* action, const char* commandId) {
-  uint8_t pin = deviceConfig.getPulsePin();
-  bool inverted = deviceConfig.getPulseInverted();
+bool Sync::enqueueOutbound(OutboundQueue::Priority priority, OutboundTopic topic, bool retained, bool merge, uint8_t tag) {
+  bool msgPack = deviceConfig.getMqttMsgPack();
+  size_t length = msgPack
+    ? serializeMsgPack(outboundDoc, outboundBuffer, sizeof(outboundBuffer))
+    : serializeJson(outboundDoc, outboundBuffer, sizeof(outboundBuffer));
+  // PubSubClient's buffer also holds the fixed header, the topic length
+  // and the topic; a payload beyond what is left could never be published
+  size_t limit = mqttClient.getBufferSize() - MQTT_MAX_HEADER_SIZE - 2 - topicFor(topic).length();
+  if (limit > sizeof(outboundBuffer) - 1) limit = sizeof(outboundBuffer) - 1;
+  if (outboundDoc.overflowed() || length == 0 || length > limit) {
+    DEBUG_PRINT("[MQTT] Outbound message too large, dropped, bytes: ");
+    DEBUG_PRINTLN(length);
+    return false;
+  }
+
+  bool queued = outboundQueue.push(priority, topic, retained, merge, tag, (const uint8_t*)outboundBuffer, length);
+  if (!queued) {
+    DEBUG_PRINTLN("[MQTT] Outbound queue full, message dropped");
+  }
+  EncodingStats& stats = encodingStats[msgPack ? ENCODING_MSGPACK : ENCODING_JSON];
+  stats.outMessages++;
+  stats.outBytes += length;
+  return queued;
+}
+
+const String& Sync::topicFor(uint8_t topic) const {
+  switch (topic) {
+    case OUT_ACK:              return topicAck;
+    case OUT_ACCESS_CODES_ACK: return topicAccessCodesAck;
+    case OUT_EVENT:            return topicEvent;
+    default:                   return topicStatus;
+  }
+}
+
+// Publishes up to `budget` queued messages, most important first. A failed
+// publish stays at the head and is retried on a later loop; after
+// OUTBOUND_MAX_ATTEMPTS failures on a live connection it is given up, so one
+// bad message cannot hold back everything queued behind it.
+void Sync::drainOutbound(uint8_t budget) {
+  while (budget-- > 0) {
+    const OutboundQueue::Message* message = outboundQueue.front();
+    if (!message) return;
+    if (message->order != headOrder) {
+      headOrder = message->order;
+      headFailures = 0;
+    }
+    if (!mqttClient.publish(topicFor(message->topic).c_str(), outboundQueue.payloadOf(*message),
+                            message->length, message->retained)) {
+      outboundRetries++;
+      if (!mqttClient.connected() || ++headFailures < OUTBOUND_MAX_ATTEMPTS) return;
+
+      DEBUG_PRINT("[MQTT] Publish keeps failing, message dropped, bytes: ");
+      DEBUG_PRINTLN(message->length);
+      outboundAbandoned++;
+      // The batch stays in the journal and is peeked again on the next drain
+      if (message->topic == OUT_EVENT && message->tag > 0) eventsInFlight = 0;
+      outboundQueue.pop();
+      continue;
+    }
+
+    outboundMessages++;
+    if (message->topic == OUT_STATUS || message->topic == OUT_BOOT) {
+      statusBytes += message->length;
+      if (message->topic == OUT_BOOT) bootReported = true;
+    } else if (message->topic == OUT_EVENT && message->tag > 0) {
+      eventJournal.consume(message->tag);
+      eventsInFlight = 0;
+    }
+    outboundQueue.pop();
+  }
+}
+
+bool Sync::isDuplicateCommand(const char* commandId) {
+  if (!commandId || strlen(commandId) == 0) return false;
+  for (const SeenCommand& seen : seenCommands) {
+    if (seen.id[0] != '\0' && millis() - seen.seenAt < COMMAND_CACHE_TTL
+        && strncmp(seen.id, commandId, sizeof(seen.id) - 1) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
 
-  DEBUG_PRINT("[Device] Executing relay on pin: ");
-  DEBUG_PRINTLN(pin);
-  digitalWrite(pin, inverted ? LOW : HIGH);
-  delay(500);
-  digitalWrite(pin, inverted ? HIGH : LOW);
-  sendCommandAck(String(action), pin, commandId);
-  DEBUG_PRINTLN("[Device] Relay pulse completed");
+// Ring buffer: the oldest entry is overwritten
+void Sync::rememberCommand(const char* commandId) {
+  if (!commandId || strlen(commandId) == 0) return;
+  SeenCommand& seen = seenCommands[seenCommandsNext];
+  strncpy(seen.id, commandId, sizeof(seen.id) - 1);
+  seen.id[sizeof(seen.id) - 1] = '\0';
+  seen.seenAt = millis();
+  seenCommandsNext = (seenCommandsNext + 1) % COMMAND_CACHE_SIZE;
 }
 
-void Sync::sendCommandAck(String action, uint8_t gpio, const char* commandId) {
-  DynamicJsonDocument doc(256);
-  doc["action"] = action;
+// Returns false when the relay queue was full and the command was not run
+bool Sync::executeRelay(const char* action, const char* commandId) {
+  // Acked from sendRelayAck() once the pulse has actually finished
+  if (relay.request(action, commandId, &inboundTrace) == Relay::REJECTED) {
+    sendCommandAck(action, 255, commandId, "-rejected-busy");
+    return false;
+  }
+  return true;
+}
+
+void Sync::sendRelayAck(const char* action, const char* commandId, const Relay::Trace* trace) {
+  sendCommandAck(action, deviceConfig.getPulsePin(), commandId, nullptr, trace);
+}
+
+void Sync::recordReaction(uint32_t reactionMicros) {
+  uint32_t reactionMs = reactionMicros / 1000;
+  uint8_t bucket = 0;
+  while (bucket < REACTION_BUCKETS - 1 && reactionMs >= REACTION_BOUNDS_MS[bucket]) bucket++;
+  if (reactionHistogram[bucket] < 0xFFFF) reactionHistogram[bucket]++;
+  reactionHistogramChanged = true;
+}
+
+void Sync::sendCommandAck(const char* action, uint8_t gpio, const char* commandId, const char* suffix,
+                          const Relay::Trace* trace) {
+  char actionName[40];
+  snprintf(actionName, sizeof(actionName), "%s%s", action, suffix ? suffix : "");
+
+  JsonDocument& doc = outbound();
+  doc["action"] = (const char*)actionName;
   if (gpio != 255) {
     doc["pin"] = gpio;
   }
   doc["command_id"] = commandId ? commandId : "local";
+  if (trace && trace->arrived != 0) {
+    // Stage durations in µs: parse, dispatch to relay on, pulse, relay off to ack
+    JsonArray lat = doc.createNestedArray("lat");
+    lat.add(trace->parsed - trace->arrived);
+    lat.add(trace->relayOn - trace->parsed);
+    lat.add(trace->relayOff - trace->relayOn);
+    lat.add((uint32_t)micros() - trace->relayOff);
+    if (trace->transitMs != Relay::TRANSIT_UNKNOWN) {
+      doc["transit"] = trace->transitMs;
+    }
+    recordReaction(trace->relayOn - trace->arrived);
+  }
+  queueOutbound(OutboundQueue::PRIORITY_ACK, OUT_ACK);
+}
 
-  String message;
-  serializeJson(doc, message);
-  mqttClient.publish(topicAck.c_str(), message.c_str());
+void Sync::takeStatusSnapshot(StatusSnapshot& snapshot) {
+  snapshot.wifiStrength = constrain(map(WiFi.RSSI(), -100, -30, 0, 100), 0, 100);
+  snapshot.sensorValue = deviceConfig.getSensorPin() != DeviceConfig::UNCONFIGURED_PIN ? sensor.getValue() : -1;
+  snapshot.pinRejected = pinThrottle.getRejectedCount();
+  snapshot.pinLockouts = pinThrottle.getLockoutCount();
+  snapshot.eventsPending = eventJournal.getPendingCount();
+  snapshot.commandsDuplicate = duplicateCommands;
+  snapshot.inHeapDelta = inboundHeapDelta;
+  snapshot.outHeapDelta = outboundHeapDelta;
 }
 
-void Sync::sendDeviceStatus() {
-  DynamicJsonDocument doc(512);
-  doc["chip-id"] = deviceId;
+// Adds the fields of `now` that differ from `previous` (all of them when
+// there is no previous report) and returns how many were added. RSSI jitter
+// within the hysteresis is not a change; the last reported value is kept.
+uint8_t Sync::addStatusFields(JsonDocument& doc, StatusSnapshot& now, const StatusSnapshot* previous, bool& volatileChanged) {
+  uint8_t added = 0;
+  volatileChanged = false;
+
+  int32_t wifiDelta = previous ? now.wifiStrength - previous->wifiStrength : 0;
+  if (!previous || wifiDelta >= WIFI_STRENGTH_HYSTERESIS || -wifiDelta >= WIFI_STRENGTH_HYSTERESIS) {
+    doc["wifi-strength"] = now.wifiStrength;
+    volatileChanged = previous != nullptr;
+    added++;
+  } else {
+    now.wifiStrength = previous->wifiStrength;
+  }
+  if (now.sensorValue >= 0 && (!previous || now.sensorValue != previous->sensorValue)) {
+    doc["sensor_value"] = now.sensorValue;
+    volatileChanged = volatileChanged || previous != nullptr;
+    added++;
+  }
+
+  if (!previous || now.pinRejected != previous->pinRejected) { doc["pin-rejected"] = now.pinRejected; added++; }
+  if (!previous || now.pinLockouts != previous->pinLockouts) { doc["pin-lockouts"] = now.pinLockouts; added++; }
+  if (!previous || now.eventsPending != previous->eventsPending) { doc["events-pending"] = now.eventsPending; added++; }
+  if (!previous || now.commandsDuplicate != previous->commandsDuplicate) { doc["commands-duplicate"] = now.commandsDuplicate; added++; }
+  if (!previous || now.inHeapDelta != previous->inHeapDelta) { doc["mqtt-in-heap-delta"] = now.inHeapDelta; added++; }
+  if (!previous || now.outHeapDelta != previous->outHeapDelta) { doc["mqtt-out-heap-delta"] = now.outHeapDelta; added++; }
+
+  return added;
+}
+
+void Sync::sendDeviceDescriptor() {
+  heartbeatSeq = 0;
+  heartbeatInterval = HEARTBEAT_INITIAL_INTERVAL;
+  sensorChangedSinceHeartbeat = false;
+  publishRetainedState();
+  if (!bootReported) {
+    sendBootReport();
+  }
+}
+
+// Right after the first descriptor of a boot: when each boot phase ended.
+// It goes out as heartbeat seq 1, since the retained descriptor is already
+// close to the MQTT buffer size. A reconnect drops it from the queue with
+// the rest of the state, and the next descriptor queues it again.
+void Sync::sendBootReport() {
+  JsonDocument& doc = outbound();
+  doc["seq"] = ++heartbeatSeq;
+  doc["millis"] = millis();
+  bootProfile.addTo(doc.createNestedObject("boot"));
+  doc["wifi-cached"] = wifiManager.getLastConnectCached();
+  queueOutbound(OutboundQueue::PRIORITY_STATE, OUT_BOOT);
+}
+
+// The retained message on status is the whole current state: descriptor,
+// online flag and sensor reading, so a late subscriber needs nothing else
+void Sync::publishRetainedState() {
+  StatusSnapshot snapshot;
+  takeStatusSnapshot(snapshot);
+
+  JsonDocument& doc = outbound();
+  doc["full"] = true;
+  doc["state"] = "online";
+  doc["seq"] = heartbeatSeq;
+  doc["chip-id"] = deviceId.c_str();
   doc["millis"] = millis();
-  doc["wifi-strength"] = constrain(map(WiFi.RSSI(), -100, -30, 0, 100), 0, 100);
   doc["firmware-version"] = DeviceConfig::FIRMWARE_VERSION;
   doc["device-name"] = deviceConfig.getDeviceName();
-  doc["wifi-ssid"] = deviceConfig.getWifiSSID();
+  doc["wifi-ssid"] = deviceConfig.getWifiSSID(wifiManager.getNetworkIndex());
+  doc["wifi-connect-ms"] = wifiManager.getLastConnectMillis();
   doc["pulse-pin"] = deviceConfig.getPulsePin();
   doc["sensor-pin"] = deviceConfig.getSensorPin();
   doc["pulse-inverted"] = deviceConfig.getPulseInverted();
-  if (deviceConfig.getSensorPin() != DeviceConfig::UNCONFIGURED_PIN) {
-    doc["sensor_value"] = sensor.getValue();
+  doc["encoding"] = deviceConfig.getMqttMsgPack() ? "msgpack" : "json";
+  bool volatileChanged;
+  addStatusFields(doc, snapshot, nullptr, volatileChanged);
+
+  // Merged: only the newest full state is worth sending
+  queueOutbound(OutboundQueue::PRIORITY_STATE, OUT_STATUS, true, true);
+  lastReported = snapshot;
+}
+
+void Sync::sendHeartbeat() {
+  StatusSnapshot snapshot;
+  takeStatusSnapshot(snapshot);
+
+  JsonDocument& doc = outbound();
+  doc["seq"] = ++heartbeatSeq;
+  doc["millis"] = millis();
+  bool volatileChanged;
+  uint8_t changed = addStatusFields(doc, snapshot, &lastReported, volatileChanged);
+  changed += linkMonitor.addChangedStats(doc);
+  if (reactionHistogramChanged) {
+    JsonArray histogram = doc.createNestedArray("lat-hist");
+    for (uint8_t i = 0; i < REACTION_BUCKETS; i++) {
+      histogram.add(reactionHistogram[i]);
+    }
+    reactionHistogramChanged = false;
+    changed++;
   }
+  queueOutbound(OutboundQueue::PRIORITY_HEARTBEAT, OUT_STATUS);
+  lastReported = snapshot;
+
+  // Volatile RSSI or sensor readings tighten the interval, a quiet
+  // heartbeat doubles it
+  if (volatileChanged || sensorChangedSinceHeartbeat) {
+    heartbeatInterval = heartbeatInterval / 2 < HEARTBEAT_MIN_INTERVAL ? HEARTBEAT_MIN_INTERVAL : heartbeatInterval / 2;
+  } else if (changed == 0) {
+    heartbeatInterval = heartbeatInterval * 2 > HEARTBEAT_MAX_INTERVAL ? HEARTBEAT_MAX_INTERVAL : heartbeatInterval * 2;
+  }
+  sensorChangedSinceHeartbeat = false;
+}
+
+// Sensor changes replace the retained state, so whether the gate is open
+// survives for subscribers that connect later
+void Sync::sendSensorStatus() {
+  publishRetainedState();
+  sensorChangedSinceHeartbeat = true;
+}
 
-  String message;
-  serializeJson(doc, message);
-  mqttClient.publish(topicStatus.c_str(), message.c_str());
+static uint32_t perHour(uint32_t bytes) {
+  unsigned long uptime = millis();
+  return uptime > 0 ? (uint32_t)((uint64_t)bytes * 3600000ULL / uptime) : 0;
 }
 
-void Sync::sendSensorStatus(int value) {
-  DynamicJsonDocument doc(256);
-  doc["chip-id"] = deviceId;
-  doc["sensor_pin"] = deviceConfig.getSensorPin();
-  doc["sensor_value"] = value;
+uint32_t Sync::getStatusBytesPerHour() const {
+  return perHour(statusBytes);
+}
 
-  String message;
-  serializeJson(doc, message);
-  mqttClient.publish(topicStatus.c_str(), message.c_str());
+uint32_t Sync::getOutboundBytesPerHour() const {
+  return perHour(encodingStats[ENCODING_JSON].outBytes + encodingStats[ENCODING_MSGPACK].outBytes);
 }
 
 void Sync::sendPinUsage(int pinId) {
   DEBUG_PRINT("[MQTT] sendPinUsage deprecated, use sendAccessEvent. pinId: ");
   DEBUG_PRINTLN(pinId);
   // Legacy: will be replaced by sendAccessEvent in Webserver
-  DynamicJsonDocument doc(128);
+  JsonDocument& doc = outbound();
   doc["pin_id"] = pinId;
   doc["timestamp_device"] = systemClock.getUnixTime();
-  String message;
-  serializeJson(doc, message);
-  mqttClient.publish(topicEvent.c_str(), message.c_str());
+  queueOutbound(OutboundQueue::PRIORITY_EVENT, OUT_EVENT);
 }
 
 void Sync::sendAccessEvent(const char* code, const char* result, unsigned long timestamp) {
-  DynamicJsonDocument doc(256);
-  doc["pin"] = code;
-  doc["result"] = result;
-  doc["timestamp_device"] = timestamp;
+  // Journaled and published by drainEvents(), so events survive MQTT outages
+  eventJournal.append(code, strcmp(result, "valid") == 0, timestamp);
+}
 
-  String message;
-  serializeJson(doc, message);
-  mqttClient.publish(topicEvent.c_str(), message.c_str());
+void Sync::drainEvents() {
+  if (eventsInFlight > 0 || eventJournal.isEmpty() || millis() - lastEventDrain < EVENT_DRAIN_INTERVAL) return;
+  lastEventDrain = millis();
+
+  AccessEvent batch[EVENT_BATCH_SIZE];
+  uint8_t count = eventJournal.peek(batch, EVENT_BATCH_SIZE);
+  if (count == 0) return;
+
+  JsonDocument& doc = outbound();
+  JsonArray events = doc.createNestedArray("events");
+  for (uint8_t i = 0; i < count; i++) {
+    JsonObject event = events.createNestedObject();
+    event["boot"] = batch[i].boot;
+    event["seq"] = batch[i].seq;
+    event["pin"] = (const char*)batch[i].code;
+    event["result"] = batch[i].valid ? "valid" : "invalid";
+    event["timestamp_device"] = batch[i].timestamp;
+  }
+
+  // Consumed from the journal only once actually published (drainOutbound),
+  // so a reboot with the batch still queued loses nothing
+  if (queueOutbound(OutboundQueue::PRIORITY_EVENT, OUT_EVENT, false, false, count)) {
+    eventsInFlight = count;
+  }
 }
 
 void Sync::updateFirmware(const char* commandId) {
-  const char* ackCmdId = (commandId && strlen(commandId) > 0) ? commandId : "local";
+  // commandId points into the MQTT buffer, which the acks below overwrite
+  char ackCmdId[40];
+  strncpy(ackCmdId, (commandId && strlen(commandId) > 0) ? commandId : "local", sizeof(ackCmdId) - 1);
+  ackCmdId[sizeof(ackCmdId) - 1] = '\0';
 
   DEBUG_PRINTLN("[Firmware] Starting firmware update...");
   std::unique_ptr<BearSSL::WiFiClientSecure> client(new BearSSL::WiFiClientSecure);
@@ -313,6 +845,7 @@ void Sync::updateFirmware(const char* commandId) {
     } else {
       sendCommandAck("update-firmware-unknown", 255, ackCmdId);
     }
+    drainOutbound(OutboundQueue::MAX_MESSAGES);
     delay(500);  // Allow message to be sent
   }
 
@@ -336,8 +869,10 @@ bool Sync::isConnected() {
   return mqttClient.connected();
 }
 
+// The keepalive round trip is the liveness proof: a session that stops
+// answering PINGREQs is torn down within two keepalive periods
 bool Sync::isSyncing() {
-  return mqttClient.connected() && (millis() - lastSuccessfulSync < 120000);
+  return mqttClient.connected();
 }
 
 unsigned long Sync::getLastSuccessfulSync() {
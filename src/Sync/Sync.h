@@ -3,16 +3,97 @@
 
 #include <ESP8266WiFi.h>
 #include <PubSubClient.h>
+#include <WiFiClientSecureBearSSL.h>
 #include <ArduinoJson.h>
 #include "globals.h"
+#include "../EventJournal/EventJournal.h"
+#include "../InboundParser/InboundParser.h"
+#include "../LinkMonitor/LinkMonitor.h"
+#include "../OutboundQueue/OutboundQueue.h"
+#include "../Relay/Relay.h"
 
 class Sync {
+  public:
+    // Payload encodings; inbound messages are recognized by their first
+    // byte, outbound ones follow DeviceConfig's mqttMsgPack setting
+    enum Encoding : uint8_t {
+      ENCODING_JSON = 0,
+      ENCODING_MSGPACK = 1,
+      ENCODING_COUNT = 2
+    };
+    // Per-encoding traffic counters, for comparing sizes and parse times
+    struct EncodingStats {
+      uint32_t inMessages;
+      uint32_t inBytes;
+      uint32_t inParseMicros;
+      uint32_t outMessages;
+      uint32_t outBytes;
+    };
+
   private:
+    // Recently executed command_ids, so QoS1 redeliveries and backend
+    // retries are acked without firing the relay again
+    static const uint8_t COMMAND_CACHE_SIZE = 8;
+    static const unsigned long COMMAND_CACHE_TTL = 600000;  // 10 min
+    struct SeenCommand {
+      char id[40];
+      unsigned long seenAt;
+    };
+    SeenCommand seenCommands[COMMAND_CACHE_SIZE];
+    uint8_t seenCommandsNext;
+    uint32_t duplicateCommands;
+
+    // The full descriptor is published retained once per connection;
+    // heartbeats carry only the fields that changed since the last report,
+    // and their interval backs off while nothing moves
+    static const unsigned long HEARTBEAT_INITIAL_INTERVAL = 60000;
+    static const unsigned long HEARTBEAT_MIN_INTERVAL = 15000;
+    static const unsigned long HEARTBEAT_MAX_INTERVAL = 240000;
+    static const uint8_t WIFI_STRENGTH_HYSTERESIS = 5;           // percentage points
+    struct StatusSnapshot {
+      int32_t wifiStrength;
+      int32_t sensorValue;
+      uint32_t pinRejected;
+      uint32_t pinLockouts;
+      uint32_t eventsPending;
+      uint32_t commandsDuplicate;
+      int32_t inHeapDelta;
+      int32_t outHeapDelta;
+    };
+    StatusSnapshot lastReported;
+    uint32_t heartbeatSeq;
+    unsigned long heartbeatInterval;
+    bool sensorChangedSinceHeartbeat;
+    bool bootReported;      // set once the boot report is actually published
+    uint32_t statusBytes;
+    // Broker-side offline detection (LWT) and device-side stale detection
+    // (unanswered PINGREQ) both follow from the keepalive, which
+    // linkMonitor adapts to the link
+    uint32_t pingTimeouts;
+    LinkMonitor linkMonitor;
+
     WiFiClient wifiClient;
+    // MQTTS: the session survives reconnects so they resume instead of
+    // repeating the full handshake, and when the broker supports max
+    // fragment length the TLS buffers shrink from ~17 KB to ~1.5 KB
+    static const uint16_t TLS_FRAGMENT = 512;
+    // Without it BearSSL needs a 16 KB receive buffer (plus 325 B of record
+    // overhead) in one block, and room for its handshake state besides
+    static const uint16_t TLS_FULL_RECORD = 16384;
+    static const uint32_t TLS_FULL_BLOCK = TLS_FULL_RECORD + 325;
+    static const uint32_t TLS_FULL_HEAP = 22 * 1024;
+    BearSSL::WiFiClientSecure secureClient;
+    BearSSL::Session tlsSession;
+    // -1 unknown (not probed, or a failed probe not yet confirmed by a
+    // connection), 0 unsupported, 1 supported
+    int8_t tlsMfln;
+    unsigned long lastConnectMillis;
+    uint32_t lastConnectHeap;    // heap taken by the live connection
     PubSubClient mqttClient;
-    unsigned long lastReconnectAttempt;
     unsigned long lastSuccessfulSync;
     unsigned long lastHeartbeat;
+    unsigned long lastEventDrain;
+    EventJournal eventJournal;
     String deviceId;
     String topicCommand;
     String topicAccessCodesSync;
@@ -20,30 +101,110 @@ class Sync {
     String topicStatus;
     String topicEvent;
     String topicAccessCodesAck;
+    String topicEcho;
+    size_t topicPrefixLen;   // "device/{id}/"
+    // Sized for a 512-byte MessagePack page of ~20 compact access codes
+    StaticJsonDocument<2048> inboundDoc;
+    Relay::Trace inboundTrace;   // timestamps of the message being handled
+    uint32_t inboundMessages;
+    int32_t inboundHeapDelta;     // net heap kept by inbound messages, signed
+    StaticJsonDocument<512> outboundDoc;
+    char outboundBuffer[512];
+    uint32_t outboundMessages;
+    int32_t outboundHeapDelta;    // net heap kept by queueOutbound, signed
+    // Everything published goes through the queue; handle() drains a few
+    // messages per loop so a slow socket never delays an ack behind telemetry
+    static const uint8_t OUTBOUND_DRAIN_BUDGET = 4;
+    static const uint8_t OUTBOUND_MAX_ATTEMPTS = 5;
+    enum OutboundTopic : uint8_t {
+      OUT_ACK,
+      OUT_ACCESS_CODES_ACK,
+      OUT_STATUS,
+      OUT_EVENT,
+      OUT_BOOT      // on the status topic, kept apart so the descriptor never merges it away
+    };
+    OutboundQueue outboundQueue;
+    uint32_t outboundRetries;
+    uint32_t outboundAbandoned;   // given up after OUTBOUND_MAX_ATTEMPTS failed publishes
+    uint32_t headOrder;           // queue order of the message headFailures counts for
+    uint8_t headFailures;
+    uint8_t eventsInFlight;   // journal events in the queued batch
+
+    // Reaction latency (command arrival to relay on) histogram, in ms;
+    // the last bucket counts everything above the last bound
+    static const uint8_t REACTION_BUCKETS = 8;
+    static const uint16_t REACTION_BOUNDS_MS[REACTION_BUCKETS - 1];
+    uint16_t reactionHistogram[REACTION_BUCKETS];
+    bool reactionHistogramChanged;
+    EncodingStats encodingStats[ENCODING_COUNT];
     bool connected;
     String clientId;
 
     void subscribeToTopics();
-    void sendDeviceStatus();
+    void sendDeviceDescriptor();
+    void sendHeartbeat();
+    void sendBootReport();
+    void publishRetainedState();
+    void takeStatusSnapshot(StatusSnapshot& snapshot);
+    uint8_t addStatusFields(JsonDocument& doc, StatusSnapshot& now, const StatusSnapshot* previous, bool& volatileChanged);
     void handleCommand(JsonObject data);
     void handleAccessCodesSync(JsonObject data);
-    void executeRelay(const char* action, const char* commandId);
-    void sendCommandAck(String action, uint8_t gpio, const char* commandId);
+    void handleAccessCodeDelta(JsonObject data);
+    void handleAccessCodesPage(JsonObject data);
+    void handleInbound(char* topic, byte* payload, unsigned int length);
+    bool executeRelay(const char* action, const char* commandId);
+    void sendCommandAck(const char* action, uint8_t gpio, const char* commandId, const char* suffix = nullptr,
+                        const Relay::Trace* trace = nullptr);
+    void recordReaction(uint32_t micros);
+    JsonDocument& outbound();
+    bool queueOutbound(OutboundQueue::Priority priority, OutboundTopic topic, bool retained = false,
+                       bool merge = false, uint8_t tag = 0);
+    bool enqueueOutbound(OutboundQueue::Priority priority, OutboundTopic topic, bool retained, bool merge, uint8_t tag);
+    const String& topicFor(uint8_t topic) const;
+    void drainOutbound(uint8_t budget);
     void updateFirmware(const char* commandId);
+    void drainEvents();
+    bool isDuplicateCommand(const char* commandId);
+    void rememberCommand(const char* commandId);
     uint32_t optimizeMemoryForOTA();
     bool reconnect();
+    bool configureTls();
 
   public:
     void mqttCallback(char* topic, byte* payload, unsigned int length);
     Sync();
+    void begin();
     void handle();
     void connect();
     bool isConnected();
     bool isSyncing();
     unsigned long getLastSuccessfulSync();
-    void sendSensorStatus(int value);
+    void sendSensorStatus();
     void sendPinUsage(int pinId);
     void sendAccessEvent(const char* code, const char* result, unsigned long timestamp);
+    void sendRelayAck(const char* action, const char* commandId, const Relay::Trace* trace);
+    uint32_t getInboundMessages() const { return inboundMessages; }
+    int32_t getInboundHeapDelta() const { return inboundHeapDelta; }
+    uint32_t getOutboundMessages() const { return outboundMessages; }
+    int32_t getOutboundHeapDelta() const { return outboundHeapDelta; }
+    uint32_t getDuplicateCommands() const { return duplicateCommands; }
+    unsigned long getHeartbeatInterval() const { return heartbeatInterval; }
+    uint32_t getPingTimeouts() const { return pingTimeouts; }
+    const LinkMonitor& getLinkMonitor() const { return linkMonitor; }
+    const OutboundQueue& getOutboundQueue() const { return outboundQueue; }
+    uint32_t getOutboundRetries() const { return outboundRetries; }
+    uint32_t getOutboundAbandoned() const { return outboundAbandoned; }
+    int8_t getTlsMfln() const { return tlsMfln; }
+    unsigned long getLastConnectMillis() const { return lastConnectMillis; }
+    uint32_t getLastConnectHeap() const { return lastConnectHeap; }
+    uint16_t getReactionBucket(uint8_t bucket) const { return reactionHistogram[bucket]; }
+    static uint8_t getReactionBucketCount() { return REACTION_BUCKETS; }
+    static uint16_t getReactionBound(uint8_t bucket) { return REACTION_BOUNDS_MS[bucket]; }
+    uint32_t getStatusBytesPerHour() const;
+    uint32_t getOutboundBytesPerHour() const;
+    const EncodingStats& getEncodingStats(Encoding encoding) const { return encodingStats[encoding]; }
+    uint32_t getPendingEvents() const { return eventJournal.getPendingCount(); }
+    uint32_t getDroppedEvents() const { return eventJournal.getDroppedCount(); }
 };
 
 #endif
@@ -5,27 +5,48 @@
 #include <ctime> // For time_t, gmtime, strftime
 #include <LittleFS.h>
 
+static String formatUnixTime(unsigned long unix_timestamp) {
+  if (unix_timestamp == 0) return "N/A (Não sincronizado)";
+
+  time_t rawtime = unix_timestamp;
+  struct tm * ti;
+  ti = localtime(&rawtime); // Use localtime for local time, or gmtime for UTC
+
+  char buffer[64]; // Increased size to safely accommodate the formatted string
+  // Example: 2025-11-26 14:30:00
+  snprintf(buffer, sizeof(buffer), "%04d-%02d-%02d %02d:%02d:%02d",
+          ti->tm_year + 1900, ti->tm_mon + 1, ti->tm_mday,
+          ti->tm_hour, ti->tm_min, ti->tm_sec);
+  return String(buffer);
+}
+
+static void addEncodingStats(JsonObject target, const Sync::EncodingStats& stats) {
+  target["in"] = stats.inMessages;
+  target["in-bytes"] = stats.inBytes;
+  target["in-us"] = stats.inParseMicros;
+  target["out"] = stats.outMessages;
+  target["out-bytes"] = stats.outBytes;
+}
+
 // Initialize static instance pointer
 Webserver* Webserver::instance = nullptr;
+StaticJsonDocument<2560> Webserver::responseDoc;
 
 Webserver::Webserver(): server(80) {
   instance = this;  // Set the instance pointer
 }
 
+// LittleFS is already mounted: setup() does it before WiFi starts
 void Webserver::begin() {
-  if (!LittleFS.begin()) {
-    DEBUG_PRINTLN("[Webserver] LittleFS Mount Failed. Attempting to format...");
-    if (!LittleFS.format()) {
-       DEBUG_PRINTLN("[Webserver] LittleFS Format Failed.");
-    } else {
-       DEBUG_PRINTLN("[Webserver] LittleFS Format Success. Mounting...");
-       LittleFS.begin();
-    }
-  }
-
   server.on("/config", handleConfig);
   server.on("/saveconfig", HTTP_POST, handleSaveConfig);
   server.on("/info", handleInfo);
+  server.on("/page.js", handlePageScript);
+  server.on("/api/config", handleApiConfig);
+  server.on("/api/status", handleApiStatus);
+  server.on("/api/info", handleApiInfo);
+  server.on("/api/sensor", handleApiSensor);
+  server.on("/events", handleEvents);
 
   if (deviceConfig.isConfigured()) {
     server.on("/", handleIndex);
@@ -35,39 +56,15 @@ void Webserver::begin() {
 
   server.on("/pulse", handlePulse);
   server.onNotFound(handleNotFound);
+
+  static const char* collected[] = {"If-None-Match"};
+  server.collectHeaders(collected, 1);
   server.begin();
 }
 
 void Webserver::handleConfig() {
-  sendHtml("/config.html", [](String html) -> String {
-    html.replace("%CHIP_ID%", String(ESP.getChipId(), HEX));
-    html.replace("%DEVICE_NAME%", String(deviceConfig.getDeviceName()));
-    html.replace("%PASSWORD%", String(deviceConfig.getPassword()));
-    html.replace("%PULSE_PIN%", String(deviceConfig.getPulsePin()));
-    html.replace("%PIN%", String(deviceConfig.getPin()));
-    html.replace("%PULSE_INVERTED_CHECK%", deviceConfig.getPulseInverted() ? " checked" : "");
-    html.replace("%PULSE_INVERTED_CHECKED%", deviceConfig.getPulseInverted() ? " checked" : "");
-    html.replace("%SENSOR_PIN%", deviceConfig.getSensorPin() == DeviceConfig::UNCONFIGURED_PIN ? "" : String(deviceConfig.getSensorPin()));
-    html.replace("%WIFI_SSID%", String(deviceConfig.getWifiSSID()));
-    html.replace("%WIFI_PASS%", String(deviceConfig.getWifiNetworkPass()));
-    html.replace("%MQTT_HOST%", String(deviceConfig.getMqttHost()));
-    html.replace("%MQTT_PORT%", String(deviceConfig.getMqttPort()));
-    html.replace("%MQTT_USER%", String(deviceConfig.getMqttUser()));
-    html.replace("%MQTT_PASS%", String(deviceConfig.getMqttPassword()));
-
-    // MQTT Connection Status
-    String mqttStatusHtml = "";
-    if (sync.isConnected()) {
-        mqttStatusHtml = "<span style='color: #4CAF50; font-weight: bold;'>● Conectado</span>";
-    } else {
-        mqttStatusHtml = "<span style='color: #f44336; font-weight: bold;'>● Desconectado</span>";
-    }
-    html.replace("%MQTT_STATUS_HTML%", mqttStatusHtml);
-
-    return html;
-  });
+  sendStatic("/config.html", "text/html");
 }
-
 void Webserver::handleSaveConfig() {
   if (
     instance->server.hasArg("devicename")
@@ -94,6 +91,9 @@ void Webserver::handleSaveConfig() {
       deviceConfig.setPassword(password.c_str());
       deviceConfig.setPulsePin(pulsePinStr.toInt());
       deviceConfig.setPulseInverted(pulseInvertedStr == "true");
+      if (instance->server.hasArg("pulsewidth") && instance->server.arg("pulsewidth").length() > 0) {
+        deviceConfig.setPulseWidth((uint16_t)instance->server.arg("pulsewidth").toInt());
+      }
       deviceConfig.setPin(pin.c_str());
 
       if (sensorPinStr.length() > 0) {
@@ -107,6 +107,17 @@ void Webserver::handleSaveConfig() {
         deviceConfig.setWifiSSID(wifiSSID.c_str());
         deviceConfig.setWifiNetworkPass(wifiPass.c_str());
       }
+      if (instance->server.hasArg("wifissid2")) {
+        deviceConfig.setWifiFallback(0, instance->server.arg("wifissid2").c_str(), instance->server.arg("wifipass2").c_str());
+      }
+      if (instance->server.hasArg("wifissid3")) {
+        deviceConfig.setWifiFallback(1, instance->server.arg("wifissid3").c_str(), instance->server.arg("wifipass3").c_str());
+      }
+      if (instance->server.hasArg("wifistaticip")) {
+        deviceConfig.setWifiStaticIp(instance->server.arg("wifistaticip").c_str(),
+                                     instance->server.arg("wifigateway").c_str(),
+                                     instance->server.arg("wifisubnet").c_str());
+      }
 
       // Set MQTT configuration if provided
       if (instance->server.hasArg("mqtthost")) {
@@ -127,6 +138,14 @@ void Webserver::handleSaveConfig() {
       if (instance->server.hasArg("mqttpass")) {
         deviceConfig.setMqttPassword(instance->server.arg("mqttpass").c_str());
       }
+      deviceConfig.setMqttMsgPack(instance->server.arg("mqttmsgpack") == "true");
+      deviceConfig.setMqttTls(instance->server.arg("mqtttls") == "true");
+      if (!deviceConfig.setMqttFingerprint(instance->server.arg("mqttfingerprint").c_str())) {
+        // Nothing is saved; a reload drops the fields already applied above
+        deviceConfig.loadConfig();
+        instance->server.send(400, "text/plain", "Invalid MQTT fingerprint: expected the 40 hex digits of the SHA-1, or empty");
+        return;
+      }
 
       deviceConfig.saveConfig();
 
@@ -146,6 +165,15 @@ void Webserver::handleNotFound() {
 
 void Webserver::handlePulse() {
   if (instance->server.hasArg("pin")) {
+    uint32_t clientIp = instance->server.client().remoteIP();
+    unsigned long retryAfter = pinThrottle.acquire(clientIp);
+    if (retryAfter > 0) {
+      eventStream.sendAccess("throttled");
+      instance->server.sendHeader("Retry-After", String((retryAfter + 999) / 1000));
+      instance->server.send(429, "application/json", "{\"success\":false,\"message\":\"Muitas tentativas, aguarde.\",\"retry_after\":" + String((retryAfter + 999) / 1000) + "}");
+      return;
+    }
+
     String pin = instance->server.arg("pin");
     pin.trim(); // Remove any accidental whitespace
     unsigned long timestamp = systemClock.getUnixTime();
@@ -153,17 +181,19 @@ void Webserver::handlePulse() {
     bool isAuthorized = accessManager.validate(pin);
 
     if (isAuthorized) {
-      uint8_t pulsePin = deviceConfig.getPulsePin();
-      bool inverted = deviceConfig.getPulseInverted();
-      digitalWrite(pulsePin, inverted ? LOW : HIGH);
-      delay(500);
-      digitalWrite(pulsePin, inverted ? HIGH : LOW);
-
+      pinThrottle.recordSuccess(clientIp);
       sync.sendAccessEvent(pin.c_str(), "valid", timestamp);
-      instance->server.send(200, "text/plain", "GPIO " + String(pulsePin) + " toggled");
+      eventStream.sendAccess("valid");
+
+      if (relay.request("pulse", nullptr) == Relay::REJECTED) {
+        instance->server.send(503, "text/plain", "Relay busy");
+        return;
+      }
+      instance->server.send(200, "text/plain", "GPIO " + String(deviceConfig.getPulsePin()) + " toggled");
     } else {
       sync.sendAccessEvent(pin.c_str(), "invalid", timestamp);
-      delay(3000); // Add 3-second delay for incorrect PIN
+      eventStream.sendAccess("invalid");
+      pinThrottle.recordFailure(clientIp);
       instance->server.send(401, "application/json", "{\"success\":false,\"message\":\"PIN incorreto!\"}");
     }
   } else {
@@ -172,154 +202,296 @@ void Webserver::handlePulse() {
 }
 
 void Webserver::handleIndex() {
-  sendHtml("/index.html", [](String html) -> String {
-    html.replace("%DEVICE_NAME%", String(deviceConfig.getDeviceName()));
-    html.replace("%CURRENT_TIME%", formatUnixTime(systemClock.getUnixTime()));
-
-    if (deviceConfig.getSensorPin() != DeviceConfig::UNCONFIGURED_PIN) {
-      bool sensorState = digitalRead(deviceConfig.getSensorPin());
-      String statusHtml = "<div class='status-display " + String(sensorState ? "status-closed" : "status-open") + "'>";
-      statusHtml += "Status: " + String(sensorState ? "FECHADO" : "ABERTO");
-      statusHtml += "</div>";
-      html.replace("%SENSOR_STATUS_HTML%", statusHtml);
-    } else {
-       html.replace("%SENSOR_STATUS_HTML%", "");
-    }
-    return html;
-  });
+  sendStatic("/index.html", "text/html");
 }
 
 void Webserver::handleInfo() {
-  sendHtml("/info.html", [](String html) -> String {
-    // Device Info
-    html.replace("%DEVICE_NAME%", String(deviceConfig.getDeviceName()));
-    html.replace("%CHIP_ID%", String(ESP.getChipId(), HEX));
-    html.replace("%FIRMWARE_VERSION%", String(DeviceConfig::FIRMWARE_VERSION));
-    
-    unsigned long uptime = millis() / 1000;
-    unsigned long days = uptime / 86400;
-    unsigned long hours = (uptime % 86400) / 3600;
-    unsigned long minutes = (uptime % 3600) / 60;
-    unsigned long seconds = uptime % 60;
-    html.replace("%UPTIME%", String(days) + "d " + String(hours) + "h " + String(minutes) + "m " + String(seconds) + "s");
-    
-    html.replace("%CURRENT_TIME%", formatUnixTime(systemClock.getUnixTime()));
-    html.replace("%PULSE_PIN%", String(deviceConfig.getPulsePin()));
-    
-    if (deviceConfig.getSensorPin() != DeviceConfig::UNCONFIGURED_PIN) {
-        html.replace("%SENSOR_PIN_INFO%", "GPIO " + String(deviceConfig.getSensorPin()) + " (" + (digitalRead(deviceConfig.getSensorPin()) ? "ALTO" : "BAIXO") + ")");
-    } else {
-        html.replace("%SENSOR_PIN_INFO%", "N/A");
-    }
+  sendStatic("/info.html", "text/html");
+}
 
-    // WiFi Info
-    if (WiFi.status() == WL_CONNECTED) {
-        html.replace("%WIFI_STATUS_CLASS%", "status-connected");
-        html.replace("%WIFI_STATUS_TEXT%", "Conectado");
-        
-        String wifiDetails = "<div class='info-row'><span class='info-label'>Nome da Rede:</span><span class='info-value'>" + WiFi.SSID() + "</span></div>";
-        wifiDetails += "<div class='info-row'><span class='info-label'>Endereço IP:</span><span class='info-value'>" + WiFi.localIP().toString() + "</span></div>";
-        wifiDetails += "<div class='info-row'><span class='info-label'>Gateway:</span><span class='info-value'>" + WiFi.gatewayIP().toString() + "</span></div>";
-        wifiDetails += "<div class='info-row'><span class='info-label'>DNS:</span><span class='info-value'>" + WiFi.dnsIP().toString() + "</span></div>";
-        
-        int32_t rssi = WiFi.RSSI();
-        int signalPercent = constrain(map(rssi, -100, -30, 0, 100), 0, 100);
-        wifiDetails += "<div class='info-row'><span class='info-label'>Potência do Sinal:</span><span class='info-value'>" + String(rssi) + " dBm (" + String(signalPercent) + "%) ";
-        wifiDetails += "<div class='signal-bar'><div class='signal-indicator' style='width:" + String(100-signalPercent) + "%'></div></div></span></div>";
-        
-        html.replace("%WIFI_DETAILS%", wifiDetails);
-    } else {
-        html.replace("%WIFI_STATUS_CLASS%", "status-disconnected");
-        html.replace("%WIFI_STATUS_TEXT%", "Desconectado");
-        html.replace("%WIFI_DETAILS%", "<div class='info-row'><span class='info-label'>Rede Configurada:</span><span class='info-value'>" + String(deviceConfig.getWifiSSID()) + "</span></div>");
-    }
+void Webserver::handlePageScript() {
+  sendStatic("/page.js", "application/javascript");
+}
 
-    // AP Info
-    html.replace("%AP_SSID%", String(deviceConfig.getDeviceName()));
-    html.replace("%AP_IP%", WiFi.softAPIP().toString());
-    html.replace("%AP_STATIONS%", String(WiFi.softAPgetStationNum()));
+// Current settings under the same names /saveconfig takes, so the config
+// page can fill its form by field name
+void Webserver::handleApiConfig() {
+  JsonDocument& doc = responseDoc;
+  doc.clear();
+  char chipId[9];
+  snprintf(chipId, sizeof(chipId), "%X", ESP.getChipId());
+  doc["chipid"] = chipId;
+  doc["devicename"] = deviceConfig.getDeviceName();
+  doc["password"] = deviceConfig.getPassword();
+  doc["pulsepin"] = deviceConfig.getPulsePin();
+  doc["pulsewidth"] = deviceConfig.getPulseWidth();
+  doc["pin"] = deviceConfig.getPin();
+  doc["pulseinverted"] = deviceConfig.getPulseInverted();
+  if (deviceConfig.getSensorPin() != DeviceConfig::UNCONFIGURED_PIN) {
+    doc["sensorpin"] = deviceConfig.getSensorPin();
+  }
+  doc["wifissid"] = deviceConfig.getWifiSSID(0);
+  doc["wifipass"] = deviceConfig.getWifiNetworkPass(0);
+  doc["wifissid2"] = deviceConfig.getWifiSSID(1);
+  doc["wifipass2"] = deviceConfig.getWifiNetworkPass(1);
+  doc["wifissid3"] = deviceConfig.getWifiSSID(2);
+  doc["wifipass3"] = deviceConfig.getWifiNetworkPass(2);
+  doc["wifistaticip"] = deviceConfig.getWifiStaticIp();
+  doc["wifigateway"] = deviceConfig.getWifiGateway();
+  doc["wifisubnet"] = deviceConfig.getWifiSubnet();
+  doc["mqtthost"] = deviceConfig.getMqttHost();
+  doc["mqttport"] = deviceConfig.getMqttPort();
+  doc["mqttuser"] = deviceConfig.getMqttUser();
+  doc["mqttpass"] = deviceConfig.getMqttPassword();
+  doc["mqtttls"] = deviceConfig.getMqttTls();
+  doc["mqttfingerprint"] = deviceConfig.getMqttFingerprint();
+  doc["mqttmsgpack"] = deviceConfig.getMqttMsgPack();
+  doc["mqttconnected"] = sync.isConnected();
+  sendJson(doc);
+}
 
-    // Sync Info
-    if (sync.isConnected()) {
-        html.replace("%SYNC_CONNECTION_CLASS%", "status-connected");
-        html.replace("%SYNC_CONNECTION_TEXT%", "Conectado");
-    } else {
-        html.replace("%SYNC_CONNECTION_CLASS%", "status-disconnected");
-        html.replace("%SYNC_CONNECTION_TEXT%", "Desconectado");
-    }
+// What /info refreshes every few seconds: only values that move on their
+// own, kept to about 200 bytes
+void Webserver::handleApiStatus() {
+  StaticJsonDocument<512> doc;
+  doc["uptime"] = millis() / 1000;
+  if (systemClock.getUnixTime() != 0) doc["time"] = formatUnixTime(systemClock.getUnixTime());
+  doc["heap"] = ESP.getFreeHeap();
+  doc["heap-block"] = ESP.getMaxFreeBlockSize();
+  if (deviceConfig.getSensorPin() != DeviceConfig::UNCONFIGURED_PIN) {
+    doc["sensor"] = digitalRead(deviceConfig.getSensorPin());
+  }
 
-    if (sync.isSyncing()) {
-        html.replace("%SYNC_STATUS_CLASS%", "status-syncing");
-        html.replace("%SYNC_STATUS_TEXT%", "Sincronizando");
-    } else if (sync.isConnected()) {
-        html.replace("%SYNC_STATUS_CLASS%", "status-disconnected");
-        html.replace("%SYNC_STATUS_TEXT%", "Parado");
-    } else {
-        html.replace("%SYNC_STATUS_CLASS%", "status-disconnected");
-        html.replace("%SYNC_STATUS_TEXT%", "Offline");
-    }
+  JsonObject wifi = doc.createNestedObject("wifi");
+  wifi["connected"] = WiFi.status() == WL_CONNECTED;
+  if (WiFi.status() == WL_CONNECTED) {
+    wifi["ssid"] = WiFi.SSID();
+    wifi["network"] = wifiManager.getNetworkIndex() + 1;
+    wifi["channel"] = WiFi.channel();
+    wifi["ip"] = WiFi.localIP().toString();
+    wifi["rssi"] = WiFi.RSSI();
+  } else {
+    wifi["ssid"] = deviceConfig.getWifiSSID();
+  }
+  doc["ap-stations"] = WiFi.softAPgetStationNum();
 
-    unsigned long lastSync = sync.getLastSuccessfulSync();
-    if (lastSync > 0) {
-        unsigned long timeSinceSync = (millis() - lastSync) / 1000;
-        String timeText;
-        if (timeSinceSync < 60) {
-            timeText = String(timeSinceSync) + " segundos atrás";
-        } else if (timeSinceSync < 3600) {
-            timeText = String(timeSinceSync / 60) + " minutos atrás";
-        } else if (timeSinceSync < 86400) {
-            timeText = String(timeSinceSync / 3600) + " horas atrás";
-        } else {
-            timeText = String(timeSinceSync / 86400) + " dias atrás";
-        }
-        html.replace("%LAST_SYNC_CLASS%", "");
-        html.replace("%LAST_SYNC_TEXT%", timeText);
-    } else {
-        html.replace("%LAST_SYNC_CLASS%", "status-disconnected");
-        html.replace("%LAST_SYNC_TEXT%", "Nunca sincronizado");
-    }
+  JsonObject mqtt = doc.createNestedObject("mqtt");
+  mqtt["connected"] = sync.isConnected();
+  mqtt["syncing"] = sync.isSyncing();
+  if (sync.getLastSuccessfulSync() != 0) {
+    mqtt["last-sync"] = (millis() - sync.getLastSuccessfulSync()) / 1000;
+  }
+  sendJson(doc);
+}
 
-    return html;
-  });
+// Identity and counters for /info, fetched far less often than the status
+void Webserver::handleApiInfo() {
+  JsonDocument& doc = responseDoc;
+  doc.clear();
+  char chipId[9];
+  snprintf(chipId, sizeof(chipId), "%X", ESP.getChipId());
+  doc["device"] = deviceConfig.getDeviceName();
+  doc["chip"] = chipId;
+  doc["firmware"] = DeviceConfig::FIRMWARE_VERSION;
+  doc["pulse-pin"] = deviceConfig.getPulsePin();
+  if (deviceConfig.getSensorPin() != DeviceConfig::UNCONFIGURED_PIN) {
+    doc["sensor-pin"] = deviceConfig.getSensorPin();
+  }
+
+  JsonObject relayStats = doc.createNestedObject("relay");
+  relayStats["pulses"] = relay.getPulseCount();
+  relayStats["coalesced"] = relay.getCoalescedCount();
+  relayStats["max-gap-us"] = relay.getMaxLoopGapMicros();
+
+  JsonObject access = doc.createNestedObject("access");
+  access["codes"] = accessManager.getPinCount();
+  access["capacity"] = AccessManager::MAX_PINS;
+  access["active"] = accessManager.getActiveCount();
+  access["load-ms"] = accessManager.getLoadMillis();
+  access["cleanup-us"] = accessManager.getLastCleanupMicros();
+  access["cleanup-max-us"] = accessManager.getMaxCleanupMicros();
+  access["bytes-per-code"] = AccessManager::getBytesPerCode();
+
+  JsonObject throttle = doc.createNestedObject("throttle");
+  throttle["rejected"] = pinThrottle.getRejectedCount();
+  throttle["lockouts"] = pinThrottle.getLockoutCount();
+  throttle["active"] = pinThrottle.getActiveLockouts();
+
+  bootProfile.addTo(doc.createNestedObject("boot"));
+
+  JsonObject wifi = doc.createNestedObject("wifi");
+  wifi["boot-ms"] = wifiManager.getBootConnectMillis();
+  wifi["last-ms"] = wifiManager.getLastConnectMillis();
+  wifi["last-cached"] = wifiManager.getLastConnectCached();
+  wifi["average-ms"] = wifiManager.getAverageConnectMillis();
+  wifi["max-ms"] = wifiManager.getMaxConnectMillis();
+  wifi["connects"] = wifiManager.getConnects();
+  wifi["cached"] = wifiManager.getCachedConnects();
+  wifi["failed"] = wifiManager.getFailedAttempts();
+  wifi["disconnects"] = wifiManager.getDisconnects();
+  if (WiFi.status() == WL_CONNECTED) {
+    wifi["gateway"] = WiFi.gatewayIP().toString();
+    wifi["dns"] = WiFi.dnsIP().toString();
+  }
+
+  JsonObject ap = doc.createNestedObject("ap");
+  ap["ssid"] = deviceConfig.getDeviceName();
+  ap["ip"] = WiFi.softAPIP().toString();
+
+  JsonObject events = doc.createNestedObject("events");
+  events["subscribers"] = eventStream.getSubscriberCount();
+  events["capacity"] = EventStream::MAX_SUBSCRIBERS;
+  events["dropped"] = eventStream.getDroppedCount();
+
+  JsonObject mqtt = doc.createNestedObject("mqtt");
+  mqtt["tls"] = deviceConfig.getMqttTls();
+  mqtt["fingerprint"] = strlen(deviceConfig.getMqttFingerprint()) > 0;
+  mqtt["mfln"] = sync.getTlsMfln();
+  mqtt["connect-ms"] = sync.getLastConnectMillis();
+  mqtt["connect-heap"] = sync.getLastConnectHeap();
+  mqtt["events-pending"] = sync.getPendingEvents();
+  mqtt["events-dropped"] = sync.getDroppedEvents();
+  mqtt["msgpack"] = deviceConfig.getMqttMsgPack();
+  addEncodingStats(mqtt.createNestedObject("json-stats"), sync.getEncodingStats(Sync::ENCODING_JSON));
+  addEncodingStats(mqtt.createNestedObject("msgpack-stats"), sync.getEncodingStats(Sync::ENCODING_MSGPACK));
+  mqtt["bytes-hour"] = sync.getOutboundBytesPerHour();
+  mqtt["status-bytes-hour"] = sync.getStatusBytesPerHour();
+  mqtt["heartbeat-s"] = sync.getHeartbeatInterval() / 1000;
+  mqtt["ping-timeouts"] = sync.getPingTimeouts();
+
+  const LinkMonitor& link = sync.getLinkMonitor();
+  JsonObject rtt = mqtt.createNestedObject("rtt");
+  rtt["p50"] = link.getRttPercentile(50);
+  rtt["p90"] = link.getRttPercentile(90);
+  rtt["max"] = link.getRttPercentile(100);
+  rtt["samples"] = link.getSampleCount();
+  rtt["lost"] = link.getLostProbes();
+  mqtt["keepalive"] = link.getKeepAlive();
+  mqtt["reconnects"] = link.getReconnects();
+
+  const OutboundQueue& queue = sync.getOutboundQueue();
+  JsonObject queueStats = mqtt.createNestedObject("queue");
+  queueStats["count"] = queue.getCount();
+  queueStats["bytes"] = queue.getBytesUsed();
+  queueStats["size"] = OutboundQueue::POOL_SIZE;
+  queueStats["high-water"] = queue.getHighWater();
+  queueStats["dropped"] = queue.getDroppedCount();
+  queueStats["merged"] = queue.getMergedCount();
+  queueStats["retries"] = sync.getOutboundRetries();
+  queueStats["abandoned"] = sync.getOutboundAbandoned();
+
+  // counts[i] is below bounds[i]; the last count has no upper bound
+  JsonObject reaction = mqtt.createNestedObject("reaction");
+  JsonArray bounds = reaction.createNestedArray("bounds");
+  JsonArray counts = reaction.createNestedArray("counts");
+  for (uint8_t i = 0; i < Sync::getReactionBucketCount(); i++) {
+    if (i + 1 < Sync::getReactionBucketCount()) bounds.add(Sync::getReactionBound(i));
+    counts.add(sync.getReactionBucket(i));
+  }
+  sendJson(doc);
+}
+
+// The connection stays open after the handler returns: EventStream holds its
+// own reference to the client, so the server letting go does not close it
+void Webserver::handleEvents() {
+  WiFiClient client = instance->server.client();
+  if (!eventStream.subscribe(client)) {
+    instance->server.sendHeader("Retry-After", "30");
+    instance->server.send(503, "text/plain", "Too many event subscribers");
+  }
+}
+
+// Everything the home page shows, small enough to poll
+void Webserver::handleApiSensor() {
+  StaticJsonDocument<128> doc;
+  doc["device"] = deviceConfig.getDeviceName();
+  if (systemClock.getUnixTime() != 0) doc["time"] = formatUnixTime(systemClock.getUnixTime());
+  if (deviceConfig.getSensorPin() != DeviceConfig::UNCONFIGURED_PIN) {
+    doc["closed"] = digitalRead(deviceConfig.getSensorPin()) == HIGH;
+  }
+  sendJson(doc);
 }
 
 void Webserver::handleClient() {
   server.handleClient();
 }
 
-void Webserver::sendHtml(const String& path, std::function<String(const String&)> processor) {
-  if (!LittleFS.exists(path)) {
-    instance->server.send(404, "text/plain", "File not found: " + path);
-    return;
+static uint32_t staticCrc32(uint32_t crc, const uint8_t* data, size_t length) {
+  crc = ~crc;
+  while (length--) {
+    crc ^= *data++;
+    for (uint8_t bit = 0; bit < 8; bit++) {
+      crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+    }
   }
+  return ~crc;
+}
+
+// CRC-32 of the page content. gzip already stores it in its 8-byte trailer
+// (CRC-32, then the length, little-endian), so for the compressed copies the
+// build makes it is read, not computed; a plain file is read through once.
+static uint32_t contentCrc(File& file, bool gzipped) {
+  uint8_t buffer[64];
+  if (gzipped && file.size() >= 18 && file.seek(file.size() - 8, SeekSet) && file.read(buffer, 4) == 4) {
+    file.seek(0, SeekSet);
+    return (uint32_t)buffer[0] | ((uint32_t)buffer[1] << 8) | ((uint32_t)buffer[2] << 16) | ((uint32_t)buffer[3] << 24);
+  }
+  file.seek(0, SeekSet);
+  uint32_t crc = 0;
+  size_t length;
+  while ((length = file.read(buffer, sizeof(buffer))) > 0) {
+    crc = staticCrc32(crc, buffer, length);
+  }
+  file.seek(0, SeekSet);
+  return crc;
+}
 
-  File file = LittleFS.open(path, "r");
+// Serves a static file, preferring the gzipped copy the build puts next to
+// it. The ETag is strong: it is the CRC-32 of the content plus the stored
+// size, so any edit to a page changes it, with or without a firmware
+// version bump, and a browser revalidating with If-None-Match gets an
+// empty 304 only while the bytes are the same.
+void Webserver::sendStatic(const char* path, const char* contentType) {
+  String gzPath = String(path) + ".gz";
+  bool gzipped = LittleFS.exists(gzPath);
+  File file = LittleFS.open(gzipped ? gzPath : String(path), "r");
   if (!file) {
-    instance->server.send(500, "text/plain", "Failed to open file: " + path);
+    instance->server.send(404, "text/plain", "File not found: " + String(path));
     return;
   }
 
-  String html = file.readString();
-  file.close();
+  char etag[24];
+  snprintf(etag, sizeof(etag), "\"%08x-%x\"", (unsigned)contentCrc(file, gzipped), (unsigned)file.size());
+  instance->server.sendHeader("ETag", etag);
+  // Cached, but revalidated on every use so an updated page shows at once
+  instance->server.sendHeader("Cache-Control", "no-cache");
 
-  if (processor) {
-    html = processor(html);
+  if (instance->server.header("If-None-Match") == etag) {
+    file.close();
+    instance->server.send(304, contentType, "");
+    return;
   }
 
-  instance->server.send(200, "text/html", html);
+  // Adds Content-Encoding: gzip for .gz files
+  instance->server.streamFile(file, contentType);
+  file.close();
 }
 
-String Webserver::formatUnixTime(unsigned long unix_timestamp) {
-  if (unix_timestamp == 0) return "N/A (Não sincronizado)";
-
-  time_t rawtime = unix_timestamp;
-  struct tm * ti;
-  ti = localtime(&rawtime); // Use localtime for local time, or gmtime for UTC
-
-  char buffer[64]; // Increased size to safely accommodate the formatted string
-  // Example: 2025-11-26 14:30:00
-  snprintf(buffer, sizeof(buffer), "%04d-%02d-%02d %02d:%02d:%02d",
-          ti->tm_year + 1900, ti->tm_mon + 1, ti->tm_mday,
-          ti->tm_hour, ti->tm_min, ti->tm_sec);
-  return String(buffer);
-}
\ No newline at end of file
+// Serializes through a fixed buffer straight into the response. The length
+// is measured first, so the reply goes out with Content-Length instead of
+// chunked encoding, and nothing but the document itself is allocated. A
+// document that overflowed has silently lost fields, so it gets a 500 instead.
+void Webserver::sendJson(const JsonDocument& doc) {
+  if (doc.overflowed()) {
+    instance->server.send(500, "text/plain", "Response too large");
+    return;
+  }
+  instance->server.sendHeader("Cache-Control", "no-store");
+  instance->server.setContentLength(measureJson(doc));
+  instance->server.send(200, "application/json", "");
+  BufferedPrint output([](const char* data, size_t length) {
+    instance->server.sendContent(data, length);
+  });
+  serializeJson(doc, output);
+  output.flush();
+}
@@ -2,17 +2,22 @@
 #define WEB_SERVER_H
 
 #include <ESP8266WebServer.h>
-#include <functional>
+#include <ArduinoJson.h>
 #include "../globals.h"
+#include "../BufferedPrint/BufferedPrint.h"
 
 class Webserver {
     private:
         ESP8266WebServer server;
         static Webserver* instance;  // Static instance pointer
 
+        // Shared by /api/config and /api/info so neither allocates per request;
+        // the server runs one handler at a time. /api/info needs about 1.9 KB
+        static StaticJsonDocument<2560> responseDoc;
+
         // Helper static function
-        static String formatUnixTime(unsigned long unix_timestamp);
-        static void sendHtml(const String& path, std::function<String(const String&)> processor);
+        static void sendStatic(const char* path, const char* contentType);
+        static void sendJson(const JsonDocument& doc);
 
         // Static handler functions
         static void handleConfig();
@@ -21,6 +26,12 @@ class Webserver {
         static void handlePulse();
         static void handleIndex();
         static void handleInfo();
+        static void handlePageScript();
+        static void handleApiConfig();
+        static void handleApiStatus();
+        static void handleApiInfo();
+        static void handleApiSensor();
+        static void handleEvents();
 
     public:
         Webserver();
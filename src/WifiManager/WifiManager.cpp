@@ -0,0 +1,304 @@
+#include <LittleFS.h>
+#include "WifiManager.h"
+#include "../globals.h"
+
+const unsigned long WifiManager::CACHED_TIMEOUT;
+const unsigned long WifiManager::SCAN_TIMEOUT;
+const unsigned long WifiManager::RETRY_INTERVAL;
+const unsigned long WifiManager::LEASE_HANDBACK;
+
+static const char WIFI_CACHE_PATH[] = "/wifi.cache";
+static const char WIFI_CACHE_TMP_PATH[] = "/wifi.tmp";
+
+static uint32_t wifiCrc32(const uint8_t* data, size_t length) {
+    uint32_t crc = 0xFFFFFFFF;
+    while (length--) {
+        crc ^= *data++;
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+static uint32_t ssidCrc(const char* ssid) {
+    return wifiCrc32((const uint8_t*)ssid, strlen(ssid));
+}
+
+WifiManager::WifiManager()
+    : state(STATE_IDLE), networkIndex(0), usingCache(false), staticIpApplied(false),
+      ipRestored(false), ipReuseSpent(false), connectedSince(0), attemptStart(0), waitStart(0), cacheValid(false),
+      gotIp(false), disconnected(false), disconnectReason(0),
+      bootConnectMillis(0), lastConnectMillis(0), maxConnectMillis(0), totalConnectMillis(0),
+      lastConnectCached(false), connects(0), cachedConnects(0), failedAttempts(0), disconnects(0) {
+    memset(&cache, 0, sizeof(cache));
+}
+
+void WifiManager::begin() {
+    if (!deviceConfig.isConfigured()) {
+        DEBUG_PRINTLN("[WiFi] No network configured");
+        return;
+    }
+
+    // The state machine owns reconnection; credentials are not written to
+    // flash on every switch between networks
+    WiFi.persistent(false);
+    WiFi.setAutoReconnect(false);
+
+    // SDK events only set flags; loop() acts on them
+    gotIpHandler = WiFi.onStationModeGotIP([this](const WiFiEventStationModeGotIP&) {
+        gotIp = true;
+    });
+    disconnectedHandler = WiFi.onStationModeDisconnected([this](const WiFiEventStationModeDisconnected& event) {
+        disconnectReason = event.reason;
+        disconnected = true;
+    });
+
+    loadCache();
+    startCycle();
+}
+
+void WifiManager::loop() {
+    switch (state) {
+        case STATE_IDLE:
+            return;
+
+        case STATE_CONNECTING: {
+            if (gotIp || WiFi.status() == WL_CONNECTED) {
+                onConnected();
+                return;
+            }
+            // These reasons are final for this attempt; anything else may
+            // still recover before the timeout
+            bool refused = false;
+            if (disconnected) {
+                disconnected = false;
+                refused = disconnectReason == WIFI_DISCONNECT_REASON_NO_AP_FOUND
+                    || disconnectReason == WIFI_DISCONNECT_REASON_AUTH_FAIL
+                    || disconnectReason == WIFI_DISCONNECT_REASON_ASSOC_FAIL
+                    || disconnectReason == WIFI_DISCONNECT_REASON_HANDSHAKE_TIMEOUT
+                    || disconnectReason == WIFI_DISCONNECT_REASON_4WAY_HANDSHAKE_TIMEOUT;
+            }
+            unsigned long timeout = usingCache ? CACHED_TIMEOUT : SCAN_TIMEOUT;
+            if (refused || millis() - attemptStart >= timeout) {
+                DEBUG_PRINT("[WiFi] Attempt failed, reason=");
+                DEBUG_PRINTLN(refused ? disconnectReason : 0);
+                attemptFailed();
+            }
+            return;
+        }
+
+        case STATE_CONNECTED:
+            if (disconnected || WiFi.status() != WL_CONNECTED) {
+                DEBUG_PRINT("[WiFi] Connection lost, reason=");
+                DEBUG_PRINTLN(disconnectReason);
+                disconnects++;
+                // The access point is most likely still there: go straight
+                // back to it before scanning
+                startCycle();
+                return;
+            }
+            if (ipRestored && millis() - connectedSince >= LEASE_HANDBACK) {
+                // The router still expects renewals for this lease
+                DEBUG_PRINTLN("[WiFi] Handing the restored address back to DHCP");
+                WiFi.config(IPAddress(0, 0, 0, 0), IPAddress(0, 0, 0, 0), IPAddress(0, 0, 0, 0));
+                staticIpApplied = false;
+                ipRestored = false;
+            }
+            return;
+
+        case STATE_WAITING:
+            if (millis() - waitStart >= RETRY_INTERVAL) {
+                startCycle();
+            }
+            return;
+    }
+}
+
+void WifiManager::startCycle() {
+    if (cacheValid) {
+        startAttempt(cache.index, true);
+        return;
+    }
+    int8_t first = nextNetwork(-1);
+    if (first < 0) {
+        state = STATE_IDLE;
+        return;
+    }
+    startAttempt(first, false);
+}
+
+void WifiManager::startAttempt(uint8_t index, bool cached) {
+    networkIndex = index;
+    usingCache = cached;
+    gotIp = false;
+    disconnected = false;
+
+    // The static address belongs to the primary network
+    bool useStatic = index == 0 && strlen(deviceConfig.getWifiStaticIp()) > 0;
+    bool reuseIp = cached && !useStatic && !ipReuseSpent && cache.ip != 0;
+    ipReuseSpent = true;
+    ipRestored = false;
+    if (reuseIp) {
+        WiFi.config(IPAddress(cache.ip), IPAddress(cache.gateway), IPAddress(cache.subnet), IPAddress(cache.dns));
+        staticIpApplied = true;
+        ipRestored = true;
+    } else if (useStatic) {
+        IPAddress ip, gateway, subnet;
+        ip.fromString(deviceConfig.getWifiStaticIp());
+        gateway.fromString(deviceConfig.getWifiGateway());
+        subnet.fromString(deviceConfig.getWifiSubnet());
+        WiFi.config(ip, gateway, subnet, gateway);
+        staticIpApplied = true;
+    } else if (staticIpApplied) {
+        WiFi.config(IPAddress(0, 0, 0, 0), IPAddress(0, 0, 0, 0), IPAddress(0, 0, 0, 0));  // back to DHCP
+        staticIpApplied = false;
+    }
+
+    DEBUG_PRINT("[WiFi] Connecting to ");
+    DEBUG_PRINT(deviceConfig.getWifiSSID(index));
+    DEBUG_PRINTLN(cached ? " (cached channel/BSSID)" : "");
+    if (cached) {
+        WiFi.begin(deviceConfig.getWifiSSID(index), deviceConfig.getWifiNetworkPass(index), cache.channel, cache.bssid);
+    } else {
+        WiFi.begin(deviceConfig.getWifiSSID(index), deviceConfig.getWifiNetworkPass(index));
+    }
+    attemptStart = millis();
+    state = STATE_CONNECTING;
+}
+
+void WifiManager::attemptFailed() {
+    failedAttempts++;
+    if (usingCache) {
+        // The access point moved or is gone; scan the list from the top
+        clearCache();
+        startCycle();
+        return;
+    }
+    int8_t next = nextNetwork(networkIndex);
+    if (next >= 0) {
+        startAttempt(next, false);
+        return;
+    }
+    DEBUG_PRINTLN("[WiFi] No network available, retrying later");
+    WiFi.disconnect();
+    waitStart = millis();
+    state = STATE_WAITING;
+}
+
+void WifiManager::onConnected() {
+    lastConnectMillis = millis() - attemptStart;
+    if (lastConnectMillis > maxConnectMillis) maxConnectMillis = lastConnectMillis;
+    totalConnectMillis += lastConnectMillis;
+    lastConnectCached = usingCache;
+    connects++;
+    if (usingCache) cachedConnects++;
+    if (bootConnectMillis == 0) bootConnectMillis = millis();
+    bootProfile.mark(BootProfile::PHASE_WIFI);
+    connectedSince = millis();
+    gotIp = false;
+    disconnected = false;
+    state = STATE_CONNECTED;
+
+    DEBUG_PRINT("[WiFi] Connected in ms: ");
+    DEBUG_PRINT(lastConnectMillis);
+    DEBUG_PRINT(", IP: ");
+    DEBUG_PRINTLN(WiFi.localIP());
+
+    saveCache();
+}
+
+int8_t WifiManager::nextNetwork(int8_t after) const {
+    for (int8_t i = after + 1; i < DeviceConfig::WIFI_NETWORKS; i++) {
+        if (strlen(deviceConfig.getWifiSSID(i)) > 0) return i;
+    }
+    return -1;
+}
+
+void WifiManager::sealCache(Cache& entry) {
+    entry.crc = wifiCrc32((const uint8_t*)&entry + sizeof(entry.crc), sizeof(entry) - sizeof(entry.crc));
+}
+
+bool WifiManager::cacheIntact(const Cache& entry) {
+    return entry.crc == wifiCrc32((const uint8_t*)&entry + sizeof(entry.crc), sizeof(entry) - sizeof(entry.crc))
+        && entry.index < DeviceConfig::WIFI_NETWORKS
+        && strlen(deviceConfig.getWifiSSID(entry.index)) > 0
+        && entry.ssidCrc == ssidCrc(deviceConfig.getWifiSSID(entry.index));
+}
+
+// RTC memory first, since it also has the lease; after a power loss only
+// the flash copy is left
+void WifiManager::loadCache() {
+    Cache stored;
+    cacheValid = ESP.rtcUserMemoryRead(RTC_OFFSET, (uint32_t*)&stored, sizeof(stored)) && cacheIntact(stored);
+    if (!cacheValid) {
+        cacheValid = readFlashCache(stored) && cacheIntact(stored);
+    }
+    if (cacheValid) cache = stored;
+}
+
+bool WifiManager::readFlashCache(Cache& entry) {
+    File file = LittleFS.open(WIFI_CACHE_PATH, "r");
+    if (!file) return false;
+    bool complete = file.read((uint8_t*)&entry, sizeof(entry)) == sizeof(entry);
+    file.close();
+    return complete;
+}
+
+// Written to a temp file and renamed over the old copy, so a power cut
+// leaves one whole copy or the other. It is kept out of the EEPROM sector,
+// whose every commit erases and rewrites the config with it.
+void WifiManager::writeFlashCache(const Cache& entry) {
+    File file = LittleFS.open(WIFI_CACHE_TMP_PATH, "w");
+    if (!file) {
+        DEBUG_PRINTLN("[WiFi] Failed to open the access point cache");
+        return;
+    }
+    bool complete = file.write((const uint8_t*)&entry, sizeof(entry)) == sizeof(entry);
+    file.close();
+    if (complete) {
+        LittleFS.rename(WIFI_CACHE_TMP_PATH, WIFI_CACHE_PATH);
+    } else {
+        LittleFS.remove(WIFI_CACHE_TMP_PATH);
+    }
+}
+
+void WifiManager::saveCache() {
+    int32_t channel = WiFi.channel();
+    uint8_t* bssid = WiFi.BSSID();
+    if (channel <= 0 || bssid == nullptr) return;
+
+    Cache fresh;
+    memset(&fresh, 0, sizeof(fresh));
+    fresh.index = networkIndex;
+    fresh.channel = channel;
+    memcpy(fresh.bssid, bssid, sizeof(fresh.bssid));
+    fresh.ssidCrc = ssidCrc(deviceConfig.getWifiSSID(networkIndex));
+
+    // Flash only learns about a new access point, so it is rarely written
+    Cache flash;
+    sealCache(fresh);
+    if (!readFlashCache(flash) || memcmp(&flash, &fresh, sizeof(fresh)) != 0) {
+        writeFlashCache(fresh);
+    }
+
+    if (!staticIpApplied || ipRestored) {
+        fresh.ip = (uint32_t)WiFi.localIP();
+        fresh.gateway = (uint32_t)WiFi.gatewayIP();
+        fresh.subnet = (uint32_t)WiFi.subnetMask();
+        fresh.dns = (uint32_t)WiFi.dnsIP();
+    }
+    sealCache(fresh);
+
+    // RTC writes are cheap, but skip them when nothing moved
+    if (cacheValid && memcmp(&fresh, &cache, sizeof(fresh)) == 0) return;
+    cache = fresh;
+    cacheValid = true;
+    ESP.rtcUserMemoryWrite(RTC_OFFSET, (uint32_t*)&cache, sizeof(cache));
+}
+
+void WifiManager::clearCache() {
+    cacheValid = false;
+    memset(&cache, 0, sizeof(cache));
+    ESP.rtcUserMemoryWrite(RTC_OFFSET, (uint32_t*)&cache, sizeof(cache));
+}
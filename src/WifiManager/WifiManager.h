@@ -0,0 +1,106 @@
+#ifndef WIFIMANAGER_H
+#define WIFIMANAGER_H
+
+#include <Arduino.h>
+#include <ESP8266WiFi.h>
+
+// Station connection as a state machine driven from loop(), so association
+// never blocks the web server, captive DNS or the relay. The channel and
+// BSSID of the last good access point are kept in RTC memory and in a
+// LittleFS file, and reconnects go straight to that access point without a
+// scan. If that fails, the configured networks are tried in priority order,
+// then the cycle waits and starts again.
+//
+// The RTC copy, which only survives restarts, also keeps the DHCP lease:
+// the first attempt after a restart reuses that address instead of waiting
+// for DHCP, and hands back to DHCP once the lease has been used a while.
+class WifiManager {
+public:
+    enum State : uint8_t {
+        STATE_IDLE,         // no network configured
+        STATE_CONNECTING,
+        STATE_CONNECTED,
+        STATE_WAITING       // every network failed, waiting to retry
+    };
+
+    WifiManager();
+    void begin();
+    void loop();
+
+    State getState() const { return state; }
+    bool isConnected() const { return state == STATE_CONNECTED; }
+    uint8_t getNetworkIndex() const { return networkIndex; }
+
+    // Time-to-connect, from WiFi.begin() to an IP address, in ms
+    unsigned long getBootConnectMillis() const { return bootConnectMillis; }  // since power-on, 0 until connected
+    unsigned long getLastConnectMillis() const { return lastConnectMillis; }
+    unsigned long getMaxConnectMillis() const { return maxConnectMillis; }
+    unsigned long getAverageConnectMillis() const { return connects > 0 ? totalConnectMillis / connects : 0; }
+    bool getLastConnectCached() const { return lastConnectCached; }
+    uint32_t getConnects() const { return connects; }
+    uint32_t getCachedConnects() const { return cachedConnects; }
+    uint32_t getFailedAttempts() const { return failedAttempts; }
+    uint32_t getDisconnects() const { return disconnects; }
+
+private:
+    static const unsigned long CACHED_TIMEOUT = 5000;   // known channel and BSSID
+    static const unsigned long SCAN_TIMEOUT = 15000;
+    static const unsigned long RETRY_INTERVAL = 30000;
+    static const uint32_t RTC_OFFSET = 32;              // in 4-byte blocks; the first 128 bytes belong to eboot
+    static const unsigned long LEASE_HANDBACK = 10UL * 60000UL;  // a reused address goes back to DHCP after this
+
+    struct Cache {
+        uint32_t crc;
+        uint32_t ssidCrc;   // the cached network's SSID, so a config change invalidates it
+        uint8_t index;
+        uint8_t channel;
+        uint8_t bssid[6];
+        uint32_t ip;        // DHCP lease, all zero in the flash copy
+        uint32_t gateway;
+        uint32_t subnet;
+        uint32_t dns;
+    };
+
+    State state;
+    uint8_t networkIndex;
+    bool usingCache;
+    bool staticIpApplied;
+    bool ipRestored;        // running on the address restored from RTC
+    bool ipReuseSpent;      // only the first attempt after boot may reuse it
+    unsigned long connectedSince;
+    unsigned long attemptStart;
+    unsigned long waitStart;
+    Cache cache;
+    bool cacheValid;
+
+    WiFiEventHandler gotIpHandler;
+    WiFiEventHandler disconnectedHandler;
+    volatile bool gotIp;
+    volatile bool disconnected;
+    volatile uint8_t disconnectReason;
+
+    unsigned long bootConnectMillis;
+    unsigned long lastConnectMillis;
+    unsigned long maxConnectMillis;
+    unsigned long totalConnectMillis;
+    bool lastConnectCached;
+    uint32_t connects;
+    uint32_t cachedConnects;
+    uint32_t failedAttempts;
+    uint32_t disconnects;
+
+    void startCycle();
+    void startAttempt(uint8_t index, bool cached);
+    void attemptFailed();
+    void onConnected();
+    int8_t nextNetwork(int8_t after) const;
+    void loadCache();
+    void saveCache();
+    void clearCache();
+    static bool readFlashCache(Cache& entry);
+    static void writeFlashCache(const Cache& entry);
+    static void sealCache(Cache& entry);
+    static bool cacheIntact(const Cache& entry);
+};
+
+#endif
@@ -13,12 +13,22 @@
 #include "Sync/Sync.h"
 #include "Webserver/Webserver.h"
 #include "AccessManager/AccessManager.h"
+#include "PinThrottle/PinThrottle.h"
+#include "Relay/Relay.h"
+#include "WifiManager/WifiManager.h"
+#include "BootProfile/BootProfile.h"
+#include "EventStream/EventStream.h"
 
 class DeviceConfig;
 class Sensor;
 class Sync;
 class Webserver;
 class AccessManager;
+class PinThrottle;
+class Relay;
+class WifiManager;
+class BootProfile;
+class EventStream;
 
 extern IPAddress myIP;  // AP IP, set in setupAPMode()
 
@@ -28,6 +38,11 @@ extern Sync sync;
 extern Webserver webserver;
 extern SystemClock systemClock; // Declare global Clock instance
 extern AccessManager accessManager;
+extern PinThrottle pinThrottle;
+extern Relay relay;
+extern WifiManager wifiManager;
+extern BootProfile bootProfile;
+extern EventStream eventStream;
 
 // Debug helper macros
 #ifdef DEBUG
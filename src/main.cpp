@@ -3,11 +3,15 @@
 #include <ESP8266WiFi.h>
 #include <WiFiClient.h>
 #include <DNSServer.h>
+#include <LittleFS.h>
 #include "DeviceConfig/DeviceConfig.h"
 #include "Webserver/Webserver.h"
 #include "Sync/Sync.h"
 #include "Sensor/Sensor.h"
 #include "Clock/SystemClock.h" // Include SystemClock.h
+#include "WifiManager/WifiManager.h"
+#include "BootProfile/BootProfile.h"
+#include "EventStream/EventStream.h"
 
 #include "globals.h"
 
@@ -23,15 +27,25 @@ Webserver webserver;
 Sensor sensor;
 SystemClock systemClock; // Instantiate global Clock instance
 AccessManager accessManager;
+PinThrottle pinThrottle;
+Relay relay;
+WifiManager wifiManager;
+BootProfile bootProfile;
+EventStream eventStream;
+
+const unsigned long AP_START_DEADLINE = 5000;  // ms after boot, if MQTT is not up by then
 
-unsigned long lastCheck = 0;
 unsigned long lastSyncCheck = 0;
+bool apStarted = false;
 unsigned long apModeStartTime = 0;
 unsigned int syncTimeoutCount = 0;
+const unsigned long SENSOR_STATUS_MIN_INTERVAL = 2000;  // ms between retained state publishes
+
 unsigned long lastSensorStatusSent = 0; // Controle para evitar envios muito frequentes
+bool sensorStatusPending = false;       // a change arrived inside the interval
 
 void setup() {
-  delay(1000);
+  bootProfile.mark(BootProfile::PHASE_CORE);
 
   // Initialize Serial only if DEBUG is enabled
 #ifdef DEBUG
@@ -44,61 +58,102 @@ void setup() {
   // 1. Initialize configuration
   deviceConfig.begin();
   DEBUG_PRINTLN("Configuration initialized");
+  bootProfile.mark(BootProfile::PHASE_CONFIG);
 
-  // 2. Setup pins AFTER config is loaded
-  pinMode(deviceConfig.getPulsePin(), OUTPUT);
-  digitalWrite(deviceConfig.getPulsePin(), deviceConfig.getPulseInverted() ? HIGH : LOW);
+  // 2. Setup pins AFTER config is loaded. Edges go to the local UI, and
+  // MQTT requests are acked once their pulse is over
+  relay.init(
+    [](const char* state, const char* action, bool remote) { eventStream.sendRelay(state, action, remote); },
+    [](const char* action, const char* commandId, const Relay::Trace* trace) { sync.sendRelayAck(action, commandId, trace); });
 
   sensor.init();
   DEBUG_PRINTLN("Pulse and sensor pins configured");
+  bootProfile.mark(BootProfile::PHASE_IO);
+
+  // 3. Mount the filesystem, which holds the access point WifiManager
+  // rejoins without a scan after a power cut, then start WiFi: association
+  // runs in the background while the rest of setup() loads the stored
+  // data, and MQTT connects from loop() as soon as there is an address
+  mountFilesystem();
+  if (deviceConfig.isConfigured()) {
+    WiFi.mode(WIFI_STA);
+    wifiManager.begin();
+    systemClock.setupNtp();
+  } else {
+    WiFi.mode(WIFI_AP_STA);
+  }
+  bootProfile.mark(BootProfile::PHASE_WIFI_START);
 
-  // 3. Initialize Webserver (and LittleFS)
+  // 4. Initialize Webserver
   webserver.begin();
   DEBUG_PRINTLN("Webserver and filesystem initialized");
 
-  WiFi.mode(WIFI_AP_STA);
-  setupAPMode();
+  // 5. Restore persisted access codes before the first MQTT session so
+  // syncs and local PINs see them
+  accessManager.begin();
+  sync.begin();
+  bootProfile.mark(BootProfile::PHASE_STORAGE);
 
-  // Try to connect to WiFi if configured
+  // The access point is the setup portal, so an unconfigured device gets it
+  // right away; otherwise it waits until the broker session is up
   if (! deviceConfig.isConfigured()) {
     DEBUG_PRINTLN("Device not configured or no WiFi credentials");
-    return;
+    setupAPMode();
   }
-
-  DEBUG_PRINT("Device configured. Connecting to WiFi: ");
-  DEBUG_PRINTLN(deviceConfig.getWifiSSID());
-
-  WiFi.begin(deviceConfig.getWifiSSID(), deviceConfig.getWifiNetworkPass());
-  waitForWifiConnection();
-
-  systemClock.setupNtp();
 }
 
 void loop() {
+  relay.loop();
   webserver.handleClient();
+  eventStream.loop();
   dnsServer.processNextRequest();
 
-  handleConnection();
+  wifiManager.loop();
 
   sync.handle();
+  if (! apStarted && (sync.isConnected() || millis() >= AP_START_DEADLINE)) {
+    setupAPMode();
+  }
   systemClock.loop();
-  accessManager.cleanup();
+  if (systemClock.getUnixTime() >= accessManager.getNextDeadline()) {
+    accessManager.cleanup();
+  }
 
   if (sensor.hasChanged()) {
-    if (sync.isConnected()) {
-      if (millis() - lastSensorStatusSent >= 2000) {
-        sync.sendSensorStatus(sensor.getValue());
-        lastSensorStatusSent = millis();
-        DEBUG_PRINTLN("[Main] Sensor status sent to server");
-      } else {
-        DEBUG_PRINTLN("[Main] Skipping sensor status send - too frequent");
-      }
+    eventStream.sendSensor(sensor.getValue());
+    sensorStatusPending = true;
+  }
+  // A change inside the interval is deferred, not dropped: the retained
+  // state must end on the current reading. sendSensorStatus() reads the
+  // sensor when it publishes, so a close-and-reopen sends the latest value.
+  // While disconnected the descriptor sent on reconnect carries it instead.
+  if (sensorStatusPending) {
+    if (!sync.isConnected()) {
+      sensorStatusPending = false;
+    } else if (millis() - lastSensorStatusSent >= SENSOR_STATUS_MIN_INTERVAL) {
+      sync.sendSensorStatus();
+      lastSensorStatusSent = millis();
+      sensorStatusPending = false;
+      DEBUG_PRINTLN("[Main] Sensor status sent to server");
+    }
+  }
+}
+
+void mountFilesystem() {
+  if (!LittleFS.begin()) {
+    DEBUG_PRINTLN("[Main] LittleFS Mount Failed. Attempting to format...");
+    if (!LittleFS.format()) {
+       DEBUG_PRINTLN("[Main] LittleFS Format Failed.");
+    } else {
+       DEBUG_PRINTLN("[Main] LittleFS Format Success. Mounting...");
+       LittleFS.begin();
     }
   }
 }
 
 void setupAPMode() {
   DEBUG_PRINTLN("Setting up AP mode...");
+  apStarted = true;
   WiFi.softAP(deviceConfig.getDeviceName());
   myIP = WiFi.softAPIP();
   DEBUG_PRINT("AP mode started. SSID: ");
@@ -106,59 +161,5 @@ void setupAPMode() {
   DEBUG_PRINT(", IP: ");
   DEBUG_PRINTLN(myIP);
   dnsServer.start(53, "*", myIP);
-}
-
-void handleConnection() {
-  if (! deviceConfig.isConfigured()) {
-    return;
-  }
-
-  if (millis() - lastCheck < 30000) {
-    return;
-  }
-
-  lastCheck = millis();
-  DEBUG_PRINTLN("Checking connection status...");
-
-  if (sync.isSyncing()) {
-    return;
-  }
-
-  // Check WiFi connection
-  if (WiFi.status() != WL_CONNECTED) {
-    DEBUG_PRINTLN("WiFi disconnected. Attempting to reconnect...");
-    reconnectWifi();
-    if (WiFi.status() == WL_CONNECTED) {
-      DEBUG_PRINTLN("WiFi reconnected successfully");
-      return;
-    }
-
-    DEBUG_PRINTLN("WiFi cannot reconnect.");
-    return;
-  }
-}
-
-void waitForWifiConnection() {
-    DEBUG_PRINT("Waiting for WiFi connection");
-    int timeout = 0;
-    while (WiFi.status() != WL_CONNECTED && timeout < 20) {
-      delay(1000);
-      timeout++;
-      DEBUG_PRINT(".");
-  }
-  if (WiFi.status() == WL_CONNECTED) {
-    DEBUG_PRINT("WiFi connected successfully. IP: ");
-    DEBUG_PRINTLN(WiFi.localIP());
-    return;
-  }
-
-  DEBUG_PRINTLN(" Timeout!");
-  return;
-}
-
-void reconnectWifi() {
-  DEBUG_PRINTLN("Reconnecting to WiFi...");
-  WiFi.disconnect();
-  WiFi.begin(deviceConfig.getWifiSSID(), deviceConfig.getWifiNetworkPass());
-  waitForWifiConnection();
+  bootProfile.mark(BootProfile::PHASE_AP);
 }
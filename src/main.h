@@ -3,11 +3,9 @@
 
 #include <Arduino.h>
 
+void mountFilesystem();
 void setupAPMode();
-void handleConnection();
 bool hasInternetConnection();
-void waitForWifiConnection();
-void reconnectWifi();
 void handleApMode();
 
 void initSensorEvents();
@@ -0,0 +1,165 @@
+#ifndef MOCK_ARDUINO_H
+#define MOCK_ARDUINO_H
+
+// Host stand-in for the parts of the ESP8266 Arduino core the tested modules
+// use. millis() only moves when a test advances mockMillis (or calls delay),
+// so time-dependent code is deterministic; micros() is the real host clock,
+// so the modules' own timing counters report real host durations.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HEX 16
+#define DEC 10
+
+#define LOW 0
+#define HIGH 1
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+
+#ifndef PROGMEM
+#define PROGMEM
+#endif
+#define F(s) (s)
+
+inline unsigned long mockMillis = 0;
+
+inline unsigned long millis() { return mockMillis; }
+inline unsigned long micros() {
+    static const auto origin = std::chrono::steady_clock::now();
+    return (unsigned long)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - origin).count();
+}
+inline void delay(unsigned long ms) { mockMillis += ms; }
+inline void yield() {}
+
+inline void pinMode(uint8_t, uint8_t) {}
+inline void digitalWrite(uint8_t, uint8_t) {}
+inline int digitalRead(uint8_t) { return LOW; }
+
+inline void configTime(int, int, const char*, const char* = nullptr, const char* = nullptr) {}
+
+template <typename T, typename L, typename H>
+inline T constrain(T value, L low, H high) { return value < low ? low : (value > high ? high : value); }
+
+inline long map(long x, long inMin, long inMax, long outMin, long outMax) {
+    return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+
+class String {
+public:
+    String() {}
+    String(const char* s) : value(s ? s : "") {}
+    String(const std::string& s) : value(s) {}
+    String(char c) : value(1, c) {}
+    String(int n, unsigned char base = DEC) : value(format((long long)n, base)) {}
+    String(unsigned int n, unsigned char base = DEC) : value(format((unsigned long long)n, base)) {}
+    String(long n, unsigned char base = DEC) : value(format((long long)n, base)) {}
+    String(unsigned long n, unsigned char base = DEC) : value(format((unsigned long long)n, base)) {}
+
+    const char* c_str() const { return value.c_str(); }
+    unsigned int length() const { return value.length(); }
+    bool reserve(unsigned int size) { value.reserve(size); return true; }
+    char operator[](unsigned int i) const { return i < value.length() ? value[i] : '\0'; }
+    char& operator[](unsigned int i) { return value[i]; }
+    long toInt() const { return strtol(value.c_str(), nullptr, 10); }
+    bool isEmpty() const { return value.empty(); }
+    bool startsWith(const String& prefix) const { return value.compare(0, prefix.value.size(), prefix.value) == 0; }
+    int indexOf(char c) const { size_t i = value.find(c); return i == std::string::npos ? -1 : (int)i; }
+    String substring(unsigned int from) const { return from < value.size() ? String(value.substr(from)) : String(); }
+    String substring(unsigned int from, unsigned int to) const { return from < value.size() ? String(value.substr(from, to - from)) : String(); }
+
+    bool concat(const char* s) { value += s ? s : ""; return true; }
+    bool concat(const char* s, size_t n) { value.append(s, n); return true; }
+    String& operator+=(const String& other) { value += other.value; return *this; }
+    String& operator+=(const char* s) { value += s ? s : ""; return *this; }
+    String& operator+=(char c) { value += c; return *this; }
+    friend String operator+(const String& a, const String& b) { return String(a.value + b.value); }
+    friend String operator+(const String& a, const char* b) { return String(a.value + (b ? b : "")); }
+    friend String operator+(const char* a, const String& b) { return String((a ? a : "") + b.value); }
+
+    bool operator==(const String& other) const { return value == other.value; }
+    bool operator==(const char* s) const { return value == (s ? s : ""); }
+    bool operator!=(const String& other) const { return value != other.value; }
+    bool operator!=(const char* s) const { return !(*this == s); }
+
+private:
+    std::string value;
+
+    static std::string format(long long n, unsigned char base) {
+        if (n < 0 && base == DEC) return "-" + format((unsigned long long)-n, base);
+        return format((unsigned long long)n, base);
+    }
+    static std::string format(unsigned long long n, unsigned char base) {
+        char buffer[24];
+        snprintf(buffer, sizeof(buffer), base == HEX ? "%llx" : "%llu", n);
+        return buffer;
+    }
+};
+
+// ArduinoJson's String adapter expects the core's concatenation helper type
+class StringSumHelper : public String {
+public:
+    using String::String;
+};
+
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* buffer, size_t size) {
+        size_t n = 0;
+        while (size--) n += write(*buffer++);
+        return n;
+    }
+    size_t write(const char* s) { return s ? write((const uint8_t*)s, strlen(s)) : 0; }
+    size_t write(const char* buffer, size_t size) { return write((const uint8_t*)buffer, size); }
+    virtual void flush() {}
+
+    size_t print(const char* s) { return write(s); }
+    size_t print(const String& s) { return write(s.c_str()); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(int n) { return print(String(n)); }
+    size_t print(unsigned int n) { return print(String(n)); }
+    size_t print(long n) { return print(String(n)); }
+    size_t print(unsigned long n) { return print(String(n)); }
+    template <typename T>
+    size_t println(const T& value) { size_t n = print(value); return n + write("\r\n"); }
+    size_t println() { return write("\r\n"); }
+};
+
+class HardwareSerial : public Print {
+public:
+    void begin(unsigned long) {}
+    size_t write(uint8_t c) override { return fputc(c, stdout) == EOF ? 0 : 1; }
+    using Print::write;
+};
+
+inline HardwareSerial Serial;
+
+class EspClass {
+public:
+    uint32_t random() { return (uint32_t)engine(); }
+    uint32_t getChipId() { return 0x00C0FFEE; }
+    uint32_t getFreeHeap() { return 40000; }
+    uint32_t getMaxFreeBlockSize() { return 32000; }
+    uint8_t getHeapFragmentation() { return 0; }
+    void wdtFeed() {}
+    void restart() {}
+
+private:
+    std::mt19937 engine{12345};
+};
+
+inline EspClass ESP;
+
+#endif
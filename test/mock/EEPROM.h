@@ -0,0 +1,34 @@
+#ifndef MOCK_EEPROM_H
+#define MOCK_EEPROM_H
+
+#include <Arduino.h>
+
+// Emulated EEPROM sector, erased (0xFF) like fresh flash
+class EEPROMClass {
+public:
+    EEPROMClass() { memset(data, 0xFF, sizeof(data)); }
+    void begin(size_t size) { this->size = size < sizeof(data) ? size : sizeof(data); }
+    uint8_t read(int address) const { return address >= 0 && (size_t)address < size ? data[address] : 0; }
+    void write(int address, uint8_t value) { if (address >= 0 && (size_t)address < size) data[address] = value; }
+    bool commit() { return true; }
+    bool end() { return true; }
+
+    template <typename T>
+    T& get(int address, T& value) const {
+        memcpy(&value, data + address, sizeof(T));
+        return value;
+    }
+    template <typename T>
+    const T& put(int address, const T& value) {
+        memcpy(data + address, &value, sizeof(T));
+        return value;
+    }
+
+private:
+    uint8_t data[4096];
+    size_t size = 0;
+};
+
+inline EEPROMClass EEPROM;
+
+#endif
@@ -0,0 +1,11 @@
+#ifndef MOCK_ESP8266WEBSERVER_H
+#define MOCK_ESP8266WEBSERVER_H
+
+#include <ESP8266WiFi.h>
+
+class ESP8266WebServer {
+public:
+    explicit ESP8266WebServer(int port = 80) { (void)port; }
+};
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef MOCK_IPADDRESS_H
+#define MOCK_IPADDRESS_H
+
+#include <Arduino.h>
+
+class IPAddress {
+public:
+    IPAddress() : address(0) {}
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d)
+        : address((uint32_t)a | ((uint32_t)b << 8) | ((uint32_t)c << 16) | ((uint32_t)d << 24)) {}
+    IPAddress(uint32_t address) : address(address) {}
+
+    bool fromString(const char* text) {
+        unsigned int octets[4];
+        char tail;
+        if (!text || sscanf(text, "%u.%u.%u.%u%c", &octets[0], &octets[1], &octets[2], &octets[3], &tail) != 4) return false;
+        for (unsigned int octet : octets) {
+            if (octet > 255) return false;
+        }
+        *this = IPAddress(octets[0], octets[1], octets[2], octets[3]);
+        return true;
+    }
+    String toString() const {
+        char text[16];
+        snprintf(text, sizeof(text), "%u.%u.%u.%u", address & 0xFF, (address >> 8) & 0xFF, (address >> 16) & 0xFF, address >> 24);
+        return String(text);
+    }
+    bool isSet() const { return address != 0; }
+    operator uint32_t() const { return address; }
+
+private:
+    uint32_t address;
+};
+
+#endif
@@ -0,0 +1,127 @@
+#ifndef MOCK_LITTLEFS_H
+#define MOCK_LITTLEFS_H
+
+// In-memory LittleFS. Writes land in the backing vector immediately, so a
+// test can truncate or corrupt a file (MockFS::files) to stand in for a
+// power cut mid-write. rename() replaces an existing destination, as
+// lfs_rename does.
+
+#include <Arduino.h>
+#include <map>
+#include <string>
+#include <vector>
+
+enum SeekMode { SeekSet = 0, SeekCur = 1, SeekEnd = 2 };
+
+class MockFS;
+
+class File {
+public:
+    File() : fs(nullptr), position_(0), writable(false) {}
+    File(MockFS* fs, const std::string& path, size_t position, bool writable)
+        : fs(fs), path(path), position_(position), writable(writable) {}
+
+    explicit operator bool() const { return fs != nullptr; }
+
+    size_t write(uint8_t c) { return write(&c, 1); }
+    size_t write(const uint8_t* data, size_t length);
+    size_t read(uint8_t* data, size_t length);
+    int read() { uint8_t c; return read(&c, 1) == 1 ? c : -1; }
+    int available();
+    bool seek(uint32_t position, SeekMode mode = SeekSet);
+    size_t position() const { return position_; }
+    size_t size() const;
+    const char* name() const { return path.c_str(); }
+    void close() { fs = nullptr; }
+
+private:
+    MockFS* fs;
+    std::string path;
+    size_t position_;
+    bool writable;
+};
+
+class MockFS {
+public:
+    std::map<std::string, std::vector<uint8_t>> files;
+    size_t capacity = 128 * 1024;   // the esp01_1m littlefs partition (eagle.flash.1m128.ld)
+
+    bool begin() { return true; }
+    void end() {}
+    bool format() { files.clear(); return true; }
+    bool exists(const char* path) const { return files.count(path) > 0; }
+
+    File open(const char* path, const char* mode) {
+        std::string name(path);
+        if (mode[0] == 'r') {
+            if (!files.count(name)) return File();
+            return File(this, name, 0, false);
+        }
+        if (mode[0] == 'w') {
+            files[name].clear();
+            return File(this, name, 0, true);
+        }
+        std::vector<uint8_t>& data = files[name];
+        return File(this, name, data.size(), true);
+    }
+
+    bool remove(const char* path) { return files.erase(path) > 0; }
+
+    bool rename(const char* from, const char* to) {
+        auto it = files.find(from);
+        if (it == files.end()) return false;
+        std::vector<uint8_t> data = std::move(it->second);
+        files.erase(it);
+        files[to] = std::move(data);
+        return true;
+    }
+
+    size_t usedBytes() const {
+        size_t used = 0;
+        for (const auto& file : files) used += file.second.size();
+        return used;
+    }
+};
+
+inline MockFS LittleFS;
+
+inline size_t File::write(const uint8_t* data, size_t length) {
+    if (!fs || !writable) return 0;
+    if (fs->usedBytes() + length > fs->capacity) return 0;
+    std::vector<uint8_t>& bytes = fs->files[path];
+    if (position_ + length > bytes.size()) bytes.resize(position_ + length);
+    memcpy(bytes.data() + position_, data, length);
+    position_ += length;
+    return length;
+}
+
+inline size_t File::read(uint8_t* data, size_t length) {
+    if (!fs) return 0;
+    const std::vector<uint8_t>& bytes = fs->files[path];
+    if (position_ >= bytes.size()) return 0;
+    size_t n = bytes.size() - position_ < length ? bytes.size() - position_ : length;
+    memcpy(data, bytes.data() + position_, n);
+    position_ += n;
+    return n;
+}
+
+inline int File::available() {
+    size_t total = size();
+    return position_ < total ? (int)(total - position_) : 0;
+}
+
+inline bool File::seek(uint32_t position, SeekMode mode) {
+    if (!fs) return false;
+    size_t target = mode == SeekSet ? position : (mode == SeekCur ? position_ + position : size() + position);
+    if (target > size()) return false;
+    position_ = target;
+    return true;
+}
+
+inline size_t File::size() const {
+    if (!fs) return 0;
+    auto it = fs->files.find(path);
+    return it == fs->files.end() ? 0 : it->second.size();
+}
+
+#endif
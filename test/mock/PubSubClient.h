@@ -0,0 +1,12 @@
+#ifndef MOCK_PUBSUBCLIENT_H
+#define MOCK_PUBSUBCLIENT_H
+
+#include <WiFiClient.h>
+
+class PubSubClient {
+public:
+    PubSubClient() {}
+    explicit PubSubClient(WiFiClient&) {}
+};
+
+#endif
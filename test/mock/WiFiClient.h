@@ -0,0 +1,18 @@
+#ifndef MOCK_WIFICLIENT_H
+#define MOCK_WIFICLIENT_H
+
+#include <Arduino.h>
+
+// Declaration-only: the network modules are not built for the host
+class WiFiClient : public Print {
+public:
+    size_t write(uint8_t) override { return 1; }
+    size_t write(const uint8_t*, size_t size) override { return size; }
+    using Print::write;
+    uint8_t connected() { return 0; }
+    size_t availableForWrite() { return 0; }
+    void stop() {}
+    explicit operator bool() { return false; }
+};
+
+#endif
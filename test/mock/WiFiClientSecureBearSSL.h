@@ -0,0 +1,11 @@
+#ifndef MOCK_WIFICLIENTSECUREBEARSSL_H
+#define MOCK_WIFICLIENTSECUREBEARSSL_H
+
+#include <WiFiClient.h>
+
+namespace BearSSL {
+class WiFiClientSecure : public WiFiClient {};
+class Session {};
+}
+
+#endif
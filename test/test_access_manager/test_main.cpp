@@ -0,0 +1,548 @@
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <unity.h>
+#include <climits>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+#include "globals.h"
+#include "AccessManager/AccessManager.h"
+
+// Referenced by AccessManager (master PIN, clock); only the ones it links
+DeviceConfig deviceConfig;
+SystemClock systemClock;
+
+static const unsigned long NOW = 1767225600UL;   // 2026-01-01T00:00:00Z
+static AccessManager* manager;
+
+static String codeFor(uint32_t n) {
+    char code[8];
+    snprintf(code, sizeof(code), "%07lu", (unsigned long)(n % 10000000UL));
+    return String(code);
+}
+
+static void advanceSeconds(unsigned long seconds) {
+    mockMillis += seconds * 1000UL;
+}
+
+// /pins.log layout: 4-byte magic, then packed 23-byte records
+static const size_t LOG_HEADER = 4;
+static const size_t LOG_RECORD = 23;
+
+static std::vector<uint8_t>& pinLog() {
+    return LittleFS.files["/pins.log"];
+}
+
+// One page of a paged full sync, codes as [id, pin, start, end] tuples
+static AccessManager::StageResult stagePage(const char* batch, uint16_t part, uint16_t parts, uint16_t firstId, uint16_t count) {
+    DynamicJsonDocument doc(4096);
+    JsonArray codes = doc.createNestedArray("access_codes");
+    for (uint16_t id = firstId; id < firstId + count; id++) {
+        JsonArray tuple = codes.createNestedArray();
+        tuple.add(id);
+        tuple.add(codeFor(id));
+        tuple.add(NOW - 60);
+        tuple.add(NOW + 600);
+    }
+    return manager->stageSyncPage(batch, part, parts, 7, codes);
+}
+
+// Power cycle: a fresh table rebuilt from whatever is on flash
+static void reboot() {
+    delete manager;
+    manager = new AccessManager();
+    manager->begin();
+}
+
+static double validateMicros(AccessManager& table, const String* probes, size_t probeCount, uint32_t rounds) {
+    unsigned long started = micros();
+    for (uint32_t round = 0; round < rounds; round++) {
+        for (size_t i = 0; i < probeCount; i++) {
+            table.validate(probes[i]);
+        }
+    }
+    return (double)(micros() - started) / (rounds * probeCount);
+}
+
+void setUp(void) {
+    LittleFS.format();
+    mockMillis = 0;
+    systemClock.sync(NOW);
+    manager = new AccessManager();
+}
+
+void tearDown(void) {
+    delete manager;
+}
+
+void test_validate_finds_codes_through_the_index(void) {
+    TEST_ASSERT_TRUE(manager->handlePinAction("create", 1, "1111", NOW - 60, NOW + 60));
+    TEST_ASSERT_TRUE(manager->handlePinAction("create", 2, "2222", NOW - 60, NOW + 60));
+    TEST_ASSERT_TRUE(manager->handlePinAction("create", 3, "3333", NOW + 600, NOW + 900));
+
+    TEST_ASSERT_TRUE(manager->validate("1111"));
+    TEST_ASSERT_TRUE(manager->validate("2222"));
+    TEST_ASSERT_FALSE(manager->validate("3333"));   // indexed, outside its window
+    TEST_ASSERT_FALSE(manager->validate("4444"));
+    TEST_ASSERT_FALSE(manager->validate("111"));
+}
+
+void test_update_rekeys_the_code(void) {
+    manager->handlePinAction("create", 7, "7070", NOW - 60, NOW + 60);
+    TEST_ASSERT_TRUE(manager->handlePinAction("update", 7, "7171", NOW - 60, NOW + 60));
+
+    TEST_ASSERT_FALSE(manager->validate("7070"));
+    TEST_ASSERT_TRUE(manager->validate("7171"));
+    TEST_ASSERT_EQUAL(1, manager->getPinCount());
+}
+
+void test_duplicate_codes_are_all_probed(void) {
+    // Two ids sharing a code: the second one is valid now, the first is not
+    manager->handlePinAction("create", 1, "5555", NOW + 600, NOW + 900);
+    manager->handlePinAction("create", 2, "5555", NOW - 60, NOW + 60);
+    TEST_ASSERT_TRUE(manager->validate("5555"));
+
+    manager->handlePinAction("delete", 2, "", 0, 0);
+    TEST_ASSERT_FALSE(manager->validate("5555"));
+}
+
+// Random creates, updates and deletes against a std::map model, at up to
+// half the index load: exercises linear probing, wrap-around chains,
+// backward-shift deletion and swap-and-pop position fixups.
+void test_index_matches_model_under_churn(void) {
+    std::mt19937 rng(42);
+    std::map<int, std::string> model;
+    const int idSpace = AccessManager::MAX_PINS + AccessManager::MAX_PINS / 2;
+
+    for (int step = 0; step < 20000; step++) {
+        int id = rng() % idSpace;
+        uint32_t r = rng() % 10;
+        if (r < 6) {
+            if (model.count(id) == 0 && manager->isFull()) continue;
+            String code = codeFor(rng());
+            TEST_ASSERT_TRUE(manager->handlePinAction(model.count(id) ? "update" : "create", id, code, NOW - 60, NOW + 60));
+            model[id] = code.c_str();
+        } else if (model.count(id)) {
+            TEST_ASSERT_TRUE(manager->handlePinAction("delete", id, "", 0, 0));
+            model.erase(id);
+        }
+    }
+
+    TEST_ASSERT_EQUAL(model.size(), manager->getPinCount());
+    for (const auto& entry : model) {
+        TEST_ASSERT_TRUE(manager->validate(entry.second.c_str()));
+    }
+    // Deleted and never-issued codes
+    for (int i = 0; i < 2000; i++) {
+        String code = codeFor(rng());
+        bool issued = false;
+        for (const auto& entry : model) {
+            if (entry.second == code.c_str()) { issued = true; break; }
+        }
+        TEST_ASSERT_EQUAL(issued, manager->validate(code));
+    }
+}
+
+void test_full_table_rejects_creates(void) {
+    for (uint16_t id = 0; id < AccessManager::MAX_PINS; id++) {
+        TEST_ASSERT_TRUE(manager->handlePinAction("create", id, codeFor(id), NOW - 60, NOW + 60));
+    }
+    TEST_ASSERT_TRUE(manager->isFull());
+    TEST_ASSERT_FALSE(manager->handlePinAction("create", AccessManager::MAX_PINS, "9999999", NOW - 60, NOW + 60));
+    TEST_ASSERT_FALSE(manager->validate("9999999"));
+    TEST_ASSERT_TRUE(manager->validate(codeFor(AccessManager::MAX_PINS - 1)));
+}
+
+// Average validate() cost by table size; a hit and a miss per round
+void test_benchmark_validate_latency(void) {
+    static const uint16_t SIZES[] = {10, 100, 1000, 5000};
+    double first = 0;
+    for (uint16_t size : SIZES) {
+        if (size > AccessManager::MAX_PINS) continue;
+        AccessManager* table = new AccessManager();
+        for (uint16_t id = 0; id < size; id++) {
+            table->handlePinAction("create", id, codeFor(id * 7919UL), NOW - 60, NOW + 60);
+        }
+        String probes[] = {codeFor((size / 2) * 7919UL), "0000000"};
+        double perCall = validateMicros(*table, probes, 2, 20000);
+        if (first == 0) first = perCall;
+
+        char line[96];
+        snprintf(line, sizeof(line), "validate with %u codes: %.3f us", size, perCall);
+        TEST_MESSAGE(line);
+        // Flat, not linear: 500x the codes must not cost anywhere near 500x
+        TEST_ASSERT_TRUE(perCall < first * 20 + 1);
+        delete table;
+    }
+}
+
+void test_cleanup_activates_then_expires(void) {
+    manager->handlePinAction("create", 1, "1001", NOW - 10, NOW + 100);
+    manager->handlePinAction("create", 2, "1002", NOW + 50, NOW + 200);
+    manager->handlePinAction("create", 3, "1003", NOW - 10, NOW + 20);
+
+    TEST_ASSERT_EQUAL_UINT32(NOW - 10, manager->getNextDeadline());
+    manager->cleanup();
+    TEST_ASSERT_EQUAL(2, manager->getActiveCount());
+    TEST_ASSERT_EQUAL_UINT32(NOW + 21, manager->getNextDeadline());   // expiry of id 3
+
+    advanceSeconds(21);
+    manager->cleanup();
+    TEST_ASSERT_EQUAL(2, manager->getPinCount());
+    TEST_ASSERT_FALSE(manager->validate("1003"));
+    TEST_ASSERT_EQUAL_UINT32(NOW + 50, manager->getNextDeadline());   // activation of id 2
+
+    advanceSeconds(29);
+    manager->cleanup();
+    TEST_ASSERT_EQUAL(2, manager->getActiveCount());
+    TEST_ASSERT_TRUE(manager->validate("1002"));
+
+    advanceSeconds(200);
+    manager->cleanup();
+    TEST_ASSERT_EQUAL(0, manager->getPinCount());
+    TEST_ASSERT_EQUAL(0, manager->getActiveCount());
+    TEST_ASSERT_TRUE(manager->getNextDeadline() == ULONG_MAX);
+}
+
+void test_update_reschedules(void) {
+    manager->handlePinAction("create", 1, "1001", NOW - 10, NOW + 10);
+    manager->cleanup();
+    TEST_ASSERT_EQUAL(1, manager->getActiveCount());
+
+    // Moved into the future: back to pending, and no longer expiring first
+    manager->handlePinAction("update", 1, "1001", NOW + 100, NOW + 300);
+    TEST_ASSERT_EQUAL(0, manager->getActiveCount());
+    TEST_ASSERT_EQUAL_UINT32(NOW + 100, manager->getNextDeadline());
+
+    advanceSeconds(50);
+    manager->cleanup();
+    TEST_ASSERT_EQUAL(1, manager->getPinCount());
+    TEST_ASSERT_EQUAL(0, manager->getActiveCount());
+}
+
+// Random windows and deletes, cleanup at random times: the table always holds
+// exactly the codes whose window has not ended, and the active count matches
+void test_schedule_matches_model_under_churn(void) {
+    std::mt19937 rng(7);
+    struct Window { unsigned long start; unsigned long end; };
+    std::map<int, Window> model;
+    unsigned long now = NOW;
+
+    for (int step = 0; step < 3000; step++) {
+        int id = rng() % 1500;
+        if (rng() % 4 == 0) {
+            manager->handlePinAction("delete", id, "", 0, 0);
+            model.erase(id);
+        } else if (model.count(id) || !manager->isFull()) {
+            unsigned long start = now + (rng() % 600) - 300;
+            unsigned long end = start + rng() % 900;
+            manager->handlePinAction(model.count(id) ? "update" : "create", id, codeFor(id), start, end);
+            model[id] = {start, end};
+        }
+
+        if (step % 7 == 0) {
+            unsigned long skip = rng() % 120;
+            advanceSeconds(skip);
+            now += skip;
+            manager->cleanup();
+
+            size_t active = 0;
+            for (auto it = model.begin(); it != model.end();) {
+                if (it->second.end < now) { it = model.erase(it); continue; }
+                if (it->second.start <= now) active++;
+                ++it;
+            }
+            TEST_ASSERT_EQUAL(model.size(), manager->getPinCount());
+            TEST_ASSERT_EQUAL(active, manager->getActiveCount());
+        }
+    }
+}
+
+// loop() cost with 2000 codes loaded and nothing due. The "before" figure
+// models the scan cleanup() used to do on every pass: a std::vector of
+// String-keyed records walked in full, with erase() on each expiry.
+void test_benchmark_cleanup_loop_with_2000_codes(void) {
+    static const uint16_t CODES = 2000;
+    static const uint32_t PASSES = 20000;
+    if (CODES > AccessManager::MAX_PINS) return;
+
+    struct OldPin { int id; String code; unsigned long start; unsigned long end; };
+    std::vector<OldPin> oldPins;
+    for (uint16_t id = 0; id < CODES; id++) {
+        unsigned long end = NOW + 3600 + id;
+        manager->handlePinAction("create", id, codeFor(id), NOW - 60, end);
+        oldPins.push_back({id, codeFor(id), NOW - 60, end});
+    }
+    manager->cleanup();   // activations
+    unsigned long now = systemClock.getUnixTime();
+
+    unsigned long started = micros();
+    for (uint32_t pass = 0; pass < PASSES; pass++) {
+        for (auto it = oldPins.begin(); it != oldPins.end();) {
+            if (it->end < now) it = oldPins.erase(it); else ++it;
+        }
+    }
+    double scanMicros = (double)(micros() - started) / PASSES;
+
+    started = micros();
+    for (uint32_t pass = 0; pass < PASSES; pass++) {
+        // As loop() does it
+        if (systemClock.getUnixTime() >= manager->getNextDeadline()) manager->cleanup();
+    }
+    double scheduledMicros = (double)(micros() - started) / PASSES;
+
+    // One expiry due: pops the heap instead of erasing from the middle
+    advanceSeconds(3601);
+    started = micros();
+    manager->cleanup();
+    unsigned long expiryMicros = micros() - started;
+    TEST_ASSERT_EQUAL(CODES - 1, manager->getPinCount());
+
+    char line[128];
+    snprintf(line, sizeof(line), "2000 codes, nothing due: scan %.3f us/pass, scheduled %.3f us/pass; one expiry %lu us",
+             scanMicros, scheduledMicros, expiryMicros);
+    TEST_MESSAGE(line);
+    TEST_ASSERT_TRUE(scheduledMicros < scanMicros);
+}
+
+void test_log_replays_after_reboot(void) {
+    manager->handlePinAction("create", 1, "1111", NOW - 60, NOW + 600);
+    manager->handlePinAction("create", 2, "2222", NOW - 60, NOW + 600);
+    manager->handlePinAction("create", 3, "3333", NOW - 60, NOW + 600);
+    manager->handlePinAction("update", 2, "2020", NOW - 60, NOW + 900);
+    manager->handlePinAction("delete", 3, "", 0, 0);
+
+    reboot();
+    manager->cleanup();
+    TEST_ASSERT_EQUAL(2, manager->getPinCount());
+    TEST_ASSERT_TRUE(manager->validate("1111"));
+    TEST_ASSERT_TRUE(manager->validate("2020"));
+    TEST_ASSERT_FALSE(manager->validate("2222"));
+    TEST_ASSERT_FALSE(manager->validate("3333"));
+}
+
+void test_expired_codes_are_logged_as_deleted(void) {
+    manager->handlePinAction("create", 1, "1111", NOW - 60, NOW + 10);
+    manager->handlePinAction("create", 2, "2222", NOW - 60, NOW + 600);
+    advanceSeconds(11);
+    manager->cleanup();
+    TEST_ASSERT_EQUAL(1, manager->getPinCount());
+    TEST_ASSERT_EQUAL(LOG_HEADER + 3 * LOG_RECORD, pinLog().size());
+
+    // Gone straight after replay, before any cleanup pass could drop it again
+    reboot();
+    TEST_ASSERT_EQUAL(1, manager->getPinCount());
+}
+
+void test_torn_tail_is_dropped_and_rewritten(void) {
+    for (int id = 0; id < 10; id++) {
+        manager->handlePinAction("create", id, codeFor(id), NOW - 60, NOW + 600);
+    }
+    TEST_ASSERT_EQUAL(LOG_HEADER + 10 * LOG_RECORD, pinLog().size());
+    pinLog().resize(pinLog().size() - 5);   // power cut mid-append
+
+    reboot();
+    manager->cleanup();
+    TEST_ASSERT_EQUAL(9, manager->getPinCount());
+    TEST_ASSERT_TRUE(manager->validate(codeFor(8)));
+    TEST_ASSERT_FALSE(manager->validate(codeFor(9)));
+    // Rewritten as a snapshot: sequence record plus the recovered codes
+    TEST_ASSERT_EQUAL(LOG_HEADER + 10 * LOG_RECORD, pinLog().size());
+}
+
+void test_corrupt_record_stops_replay(void) {
+    for (int id = 0; id < 10; id++) {
+        manager->handlePinAction("create", id, codeFor(id), NOW - 60, NOW + 600);
+    }
+    pinLog()[LOG_HEADER + 4 * LOG_RECORD + 5] ^= 0x40;   // inside the 5th record's code
+
+    reboot();
+    TEST_ASSERT_EQUAL(4, manager->getPinCount());
+}
+
+void test_log_stays_within_compaction_bound(void) {
+    static const int CODES = 50;
+    std::mt19937 rng(7);
+    std::map<int, std::string> model;
+    for (int id = 0; id < CODES; id++) {
+        manager->handlePinAction("create", id, codeFor(id), NOW - 60, NOW + 600);
+        model[id] = codeFor(id).c_str();
+    }
+    for (int step = 0; step < 2000; step++) {
+        int id = (int)(rng() % CODES);
+        if (model.count(id) && rng() % 4 == 0) {
+            manager->handlePinAction("delete", id, "", 0, 0);
+            model.erase(id);
+        } else {
+            String code = codeFor(rng());
+            manager->handlePinAction(model.count(id) ? "update" : "create", id, code, NOW - 60, NOW + 600);
+            model[id] = code.c_str();
+        }
+        TEST_ASSERT_TRUE(pinLog().size() <= LOG_HEADER + (2 * manager->getPinCount() + 65) * LOG_RECORD);
+    }
+    TEST_ASSERT_FALSE(LittleFS.exists("/pins.tmp"));
+
+    reboot();
+    manager->cleanup();
+    TEST_ASSERT_EQUAL(model.size(), manager->getPinCount());
+    for (const auto& entry : model) {
+        TEST_ASSERT_TRUE(manager->validate(entry.second.c_str()));
+    }
+}
+
+// Boot-time replay of 1000 codes, from the raw append log and from a
+// compacted snapshot of the same table
+void test_benchmark_load_1000_codes(void) {
+    static const uint16_t CODES = 1000;
+    if (CODES > AccessManager::MAX_PINS) return;
+
+    for (uint16_t id = 0; id < CODES; id++) {
+        manager->handlePinAction("create", id, codeFor(id), NOW - 60, NOW + 600);
+    }
+    for (uint16_t id = 0; id < CODES; id += 2) {
+        manager->handlePinAction("update", id, codeFor(id + CODES), NOW - 60, NOW + 600);
+    }
+    size_t logBytes = pinLog().size();
+    unsigned long started = micros();
+    reboot();
+    unsigned long logMicros = micros() - started;
+    TEST_ASSERT_EQUAL(CODES, manager->getPinCount());
+
+    LittleFS.files["/pins.log"].clear();
+    delete manager;
+    manager = new AccessManager();
+    for (uint16_t id = 0; id < CODES; id++) {
+        manager->handlePinAction("create", id, codeFor(id), NOW - 60, NOW + 600);
+    }
+    size_t snapshotBytes = pinLog().size();
+    started = micros();
+    reboot();
+    unsigned long snapshotMicros = micros() - started;
+    TEST_ASSERT_EQUAL(CODES, manager->getPinCount());
+
+    char line[128];
+    snprintf(line, sizeof(line), "1000 codes: log %u B loads in %lu us, %u B without updates in %lu us",
+             (unsigned)logBytes, logMicros, (unsigned)snapshotBytes, snapshotMicros);
+    TEST_MESSAGE(line);
+}
+
+// Sparse 16-bit ids exercise the id index the way backend ids do: every
+// update and delete goes through findById
+void test_id_index_matches_model_under_churn(void) {
+    std::mt19937 rng(99);
+    std::map<int, std::string> model;
+    for (int step = 0; step < 20000; step++) {
+        int id = (int)(rng() % 65535);
+        if (!model.empty() && rng() % 2 == 0) {
+            id = std::next(model.begin(), rng() % model.size())->first;
+        }
+        if (model.count(id) && rng() % 3 == 0) {
+            manager->handlePinAction("delete", id, "", 0, 0);
+            model.erase(id);
+        } else if (model.count(id) || !manager->isFull()) {
+            String code = codeFor(rng());
+            TEST_ASSERT_TRUE(manager->handlePinAction(model.count(id) ? "update" : "create", id, code, NOW - 60, NOW + 60));
+            model[id] = code.c_str();
+        }
+        TEST_ASSERT_EQUAL(model.size(), manager->getPinCount());
+    }
+
+    // Deleting each id removes exactly its own code
+    while (!model.empty()) {
+        auto entry = std::next(model.begin(), rng() % model.size());
+        TEST_ASSERT_TRUE(manager->validate(entry->second.c_str()));
+        manager->handlePinAction("delete", entry->first, "", 0, 0);
+        model.erase(entry);
+        TEST_ASSERT_EQUAL(model.size(), manager->getPinCount());
+    }
+}
+
+static unsigned long bestLoadMicros() {
+    unsigned long best = ULONG_MAX;
+    for (int round = 0; round < 5; round++) {
+        unsigned long started = micros();
+        reboot();
+        unsigned long elapsed = micros() - started;
+        if (elapsed < best) best = elapsed;
+    }
+    return best;
+}
+
+// Replay looks every record up by id; with the id index the cost per record
+// stays flat as the table grows instead of rising with it
+void test_benchmark_replay_per_record(void) {
+    static const uint16_t SMALL = 500;
+    static const uint16_t LARGE = 4000;
+    if (LARGE > AccessManager::MAX_PINS) return;
+
+    for (uint16_t id = 0; id < SMALL; id++) {
+        manager->handlePinAction("create", id, codeFor(id), NOW - 60, NOW + 600);
+    }
+    double smallMicros = (double)bestLoadMicros() / SMALL;
+
+    for (uint16_t id = SMALL; id < LARGE; id++) {
+        manager->handlePinAction("create", id, codeFor(id), NOW - 60, NOW + 600);
+    }
+    double largeMicros = (double)bestLoadMicros() / LARGE;
+    TEST_ASSERT_EQUAL(LARGE, manager->getPinCount());
+
+    char line[128];
+    snprintf(line, sizeof(line), "replay: %.3f us/record at %u codes, %.3f us/record at %u codes",
+             smallMicros, SMALL, largeMicros, LARGE);
+    TEST_MESSAGE(line);
+    TEST_ASSERT_TRUE(largeMicros < smallMicros * 2);
+}
+
+// QoS 1 redelivers a page whose ack was lost: re-acked, batch kept
+void test_redelivered_page_is_a_duplicate(void) {
+    TEST_ASSERT_EQUAL(AccessManager::STAGE_PENDING, stagePage("b1", 1, 3, 0, 4));
+    TEST_ASSERT_EQUAL(AccessManager::STAGE_DUPLICATE, stagePage("b1", 1, 3, 0, 4));
+    TEST_ASSERT_EQUAL(AccessManager::STAGE_PENDING, stagePage("b1", 2, 3, 4, 4));
+    TEST_ASSERT_EQUAL(AccessManager::STAGE_DUPLICATE, stagePage("b1", 2, 3, 4, 4));
+    TEST_ASSERT_EQUAL(AccessManager::STAGE_COMMITTED, stagePage("b1", 3, 3, 8, 4));
+
+    // Staged once each, not twice
+    TEST_ASSERT_EQUAL(12, manager->getPinCount());
+    TEST_ASSERT_EQUAL_UINT32(7, manager->getSyncSeq());
+}
+
+void test_out_of_order_page_discards_the_batch(void) {
+    manager->handlePinAction("create", 100, "1234", NOW - 60, NOW + 600);
+    TEST_ASSERT_EQUAL(AccessManager::STAGE_PENDING, stagePage("b2", 1, 3, 0, 4));
+    TEST_ASSERT_EQUAL(AccessManager::STAGE_OUT_OF_ORDER, stagePage("b2", 3, 3, 8, 4));
+    TEST_ASSERT_EQUAL(AccessManager::STAGE_OUT_OF_ORDER, stagePage("b2", 2, 3, 4, 4));
+
+    // The page staged last, but under another batch id
+    TEST_ASSERT_EQUAL(AccessManager::STAGE_PENDING, stagePage("b3", 1, 3, 0, 4));
+    TEST_ASSERT_EQUAL(AccessManager::STAGE_PENDING, stagePage("b3", 2, 3, 4, 4));
+    TEST_ASSERT_EQUAL(AccessManager::STAGE_OUT_OF_ORDER, stagePage("b4", 2, 3, 4, 4));
+
+    TEST_ASSERT_EQUAL(1, manager->getPinCount());
+    TEST_ASSERT_FALSE(LittleFS.exists("/pins.stage"));
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_validate_finds_codes_through_the_index);
+    RUN_TEST(test_update_rekeys_the_code);
+    RUN_TEST(test_duplicate_codes_are_all_probed);
+    RUN_TEST(test_index_matches_model_under_churn);
+    RUN_TEST(test_full_table_rejects_creates);
+    RUN_TEST(test_benchmark_validate_latency);
+    RUN_TEST(test_cleanup_activates_then_expires);
+    RUN_TEST(test_update_reschedules);
+    RUN_TEST(test_schedule_matches_model_under_churn);
+    RUN_TEST(test_benchmark_cleanup_loop_with_2000_codes);
+    RUN_TEST(test_log_replays_after_reboot);
+    RUN_TEST(test_expired_codes_are_logged_as_deleted);
+    RUN_TEST(test_torn_tail_is_dropped_and_rewritten);
+    RUN_TEST(test_corrupt_record_stops_replay);
+    RUN_TEST(test_log_stays_within_compaction_bound);
+    RUN_TEST(test_benchmark_load_1000_codes);
+    RUN_TEST(test_id_index_matches_model_under_churn);
+    RUN_TEST(test_benchmark_replay_per_record);
+    RUN_TEST(test_redelivered_page_is_a_duplicate);
+    RUN_TEST(test_out_of_order_page_discards_the_batch);
+    return UNITY_END();
+}
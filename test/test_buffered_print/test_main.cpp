@@ -0,0 +1,126 @@
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <unity.h>
+#include <string>
+#include <vector>
+#include "globals.h"
+#include "BufferedPrint/BufferedPrint.h"
+
+// Referenced by the other modules linked into the native build
+DeviceConfig deviceConfig;
+SystemClock systemClock;
+
+// What the sink was handed, one entry per call (sendContent() in Webserver)
+static std::vector<std::string> chunks;
+
+static void collect(const char* data, size_t length) {
+    chunks.push_back(std::string(data, length));
+}
+
+static std::string joined() {
+    std::string all;
+    for (const std::string& chunk : chunks) all += chunk;
+    return all;
+}
+
+void setUp(void) {
+    chunks.clear();
+}
+
+void tearDown(void) {
+}
+
+void test_single_bytes_go_out_in_full_chunks(void) {
+    BufferedPrint output(collect);
+    std::string expected;
+    for (int i = 0; i < 1000; i++) {
+        char c = 'a' + i % 26;
+        output.write((uint8_t)c);
+        expected += c;
+    }
+    TEST_ASSERT_EQUAL(3, chunks.size());   // the 4th chunk is still buffered
+    output.flush();
+
+    TEST_ASSERT_EQUAL(4, chunks.size());
+    TEST_ASSERT_EQUAL(BufferedPrint::OUTPUT_SIZE, chunks[0].size());
+    TEST_ASSERT_EQUAL(1000 - 3 * BufferedPrint::OUTPUT_SIZE, chunks[3].size());
+    TEST_ASSERT_TRUE(joined() == expected);
+}
+
+void test_bulk_writes_are_split_across_chunks(void) {
+    BufferedPrint output(collect);
+    std::string expected(100, 'x');
+    output.write(expected.c_str());
+    std::string bulk;
+    for (int i = 0; i < 600; i++) bulk += (char)('0' + i % 10);
+    TEST_ASSERT_EQUAL(600, output.write((const uint8_t*)bulk.data(), bulk.size()));
+    expected += bulk;
+    output.flush();
+
+    TEST_ASSERT_EQUAL(3, chunks.size());
+    TEST_ASSERT_EQUAL(BufferedPrint::OUTPUT_SIZE, chunks[0].size());
+    TEST_ASSERT_EQUAL(BufferedPrint::OUTPUT_SIZE, chunks[1].size());
+    TEST_ASSERT_TRUE(joined() == expected);
+}
+
+void test_flush_without_output_does_not_call_the_sink(void) {
+    BufferedPrint output(collect);
+    output.flush();
+    output.write("ab");
+    output.flush();
+    output.flush();
+    TEST_ASSERT_EQUAL(1, chunks.size());
+}
+
+// sendJson() announces measureJson() as Content-Length, then streams
+// serializeJson() through BufferedPrint: both must agree byte for byte
+void test_serialized_json_matches_measured_length(void) {
+    DynamicJsonDocument doc(8192);
+    doc["device"] = "Portao garagem \"fundos\"";
+    doc["firmware"] = "1.4.0";
+    JsonObject mqtt = doc.createNestedObject("mqtt");
+    mqtt["host"] = "broker.example.com";
+    mqtt["tls"] = true;
+    mqtt["mfln"] = -1;
+    JsonArray wifi = doc.createNestedArray("wifi_connect_ms");
+    for (int i = 0; i < 32; i++) wifi.add(1200 + i * 37);
+    JsonArray encodings = doc.createNestedArray("encodings");
+    for (int i = 0; i < 16; i++) {
+        JsonObject entry = encodings.createNestedObject();
+        entry["name"] = i % 2 ? "msgpack" : "json";
+        entry["in_messages"] = 100000UL + i;
+        entry["in_bytes"] = 4000000000UL - i;
+        entry["parse_us"] = 12.5 + i;
+    }
+
+    std::vector<char> reference(measureJson(doc) + 1);
+    size_t referenceLength = serializeJson(doc, reference.data(), reference.size());
+
+    BufferedPrint output(collect);
+    size_t printed = serializeJson(doc, output);
+    output.flush();
+
+    std::string body = joined();
+    TEST_ASSERT_EQUAL(measureJson(doc), printed);
+    TEST_ASSERT_EQUAL(printed, body.size());
+    TEST_ASSERT_EQUAL(referenceLength, body.size());
+    TEST_ASSERT_TRUE(body == std::string(reference.data(), referenceLength));
+    // Full-sized writes except the last one
+    TEST_ASSERT_EQUAL((body.size() + BufferedPrint::OUTPUT_SIZE - 1) / BufferedPrint::OUTPUT_SIZE, chunks.size());
+    for (size_t i = 0; i + 1 < chunks.size(); i++) {
+        TEST_ASSERT_EQUAL(BufferedPrint::OUTPUT_SIZE, chunks[i].size());
+    }
+
+    char line[96];
+    snprintf(line, sizeof(line), "%u-byte document: %u sink calls", (unsigned)body.size(), (unsigned)chunks.size());
+    TEST_MESSAGE(line);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_single_bytes_go_out_in_full_chunks);
+    RUN_TEST(test_bulk_writes_are_split_across_chunks);
+    RUN_TEST(test_flush_without_output_does_not_call_the_sink);
+    RUN_TEST(test_serialized_json_matches_measured_length);
+    return UNITY_END();
+}
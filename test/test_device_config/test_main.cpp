@@ -0,0 +1,54 @@
+#include <Arduino.h>
+#include <unity.h>
+#include "globals.h"
+#include "DeviceConfig/DeviceConfig.h"
+
+// Referenced by the other modules linked into the native build
+DeviceConfig deviceConfig;
+SystemClock systemClock;
+
+static const char* PINNED = "0123456789ABCDEF0123456789ABCDEF01234567";
+
+void setUp(void) {
+    deviceConfig.initDefaultConfig();
+    TEST_ASSERT_TRUE(deviceConfig.setMqttFingerprint(PINNED));
+}
+
+void tearDown(void) {
+}
+
+void test_openssl_fingerprint_is_stored_as_hex_digits(void) {
+    TEST_ASSERT_TRUE(deviceConfig.setMqttFingerprint(
+        "ab:cd:ef:01:23:45:67:89:AB:CD:EF:01:23:45:67:89:ab:cd:ef:01"));
+    TEST_ASSERT_EQUAL_STRING("ABCDEF0123456789ABCDEF0123456789ABCDEF01", deviceConfig.getMqttFingerprint());
+}
+
+void test_empty_fingerprint_turns_pinning_off(void) {
+    TEST_ASSERT_TRUE(deviceConfig.setMqttFingerprint(""));
+    TEST_ASSERT_EQUAL_STRING("", deviceConfig.getMqttFingerprint());
+}
+
+// A typo must be refused, not stored as "no fingerprint" (insecure TLS)
+void test_malformed_fingerprint_is_refused_and_kept(void) {
+    const char* malformed[] = {
+        "0123456789ABCDEF0123456789ABCDEF0123456",     // 39 digits
+        "0123456789ABCDEF0123456789ABCDEF012345678",   // 41 digits
+        "0123456789ABCDEF0123456789ABCDEF0123456G",    // not hex
+        "SHA1 Fingerprint=01:23:45:67:89:AB:CD:EF:01:23:45:67:89:AB:CD:EF:01:23:45:67",
+        // SHA-256
+        "0123456789ABCDEF0123456789ABCDEF0123456789ABCDEF0123456789ABCDEF",
+        ":::",
+    };
+    for (const char* fingerprint : malformed) {
+        TEST_ASSERT_FALSE_MESSAGE(deviceConfig.setMqttFingerprint(fingerprint), fingerprint);
+        TEST_ASSERT_EQUAL_STRING(PINNED, deviceConfig.getMqttFingerprint());
+    }
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_openssl_fingerprint_is_stored_as_hex_digits);
+    RUN_TEST(test_empty_fingerprint_turns_pinning_off);
+    RUN_TEST(test_malformed_fingerprint_is_refused_and_kept);
+    return UNITY_END();
+}
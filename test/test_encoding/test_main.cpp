@@ -0,0 +1,194 @@
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <ArduinoJson.h>
+#include <unity.h>
+#include <vector>
+#include "globals.h"
+#include "AccessManager/AccessManager.h"
+
+// Referenced by AccessManager (master PIN, clock); only the ones it links
+DeviceConfig deviceConfig;
+SystemClock systemClock;
+
+static const unsigned long NOW = 1767225600UL;   // 2026-01-01T00:00:00Z
+static const size_t MQTT_PAYLOAD = 512;          // Sync's PubSubClient buffer
+static AccessManager* manager;
+
+enum PageFormat { JSON_OBJECTS, MSGPACK_OBJECTS, MSGPACK_TUPLES };
+
+static String codeFor(uint32_t n) {
+    char code[8];
+    snprintf(code, sizeof(code), "%07lu", (unsigned long)(n % 10000000UL));
+    return String(code);
+}
+
+// Header of a one-page full sync; encodePage() adds 7-digit codes with
+// one-day windows and ids from 100, as the backend sends them
+static void buildPage(JsonDocument& doc) {
+    doc.clear();
+    doc["action"] = "sync_access_codes";
+    doc["command_id"] = "c-000001";
+    doc["batch"] = "b-1";
+    doc["part"] = 1;
+    doc["parts"] = 1;
+    doc["seq"] = 42;
+    doc.createNestedArray("access_codes");
+}
+
+static std::vector<uint8_t> encodePage(uint16_t codes, PageFormat format) {
+    DynamicJsonDocument doc(8192);
+    buildPage(doc);
+    JsonArray list = doc["access_codes"];
+    for (uint16_t i = 0; i < codes; i++) {
+        unsigned long start = NOW + i * 3600UL;
+        if (format == MSGPACK_TUPLES) {
+            JsonArray tuple = list.createNestedArray();
+            tuple.add(100 + i);
+            tuple.add(codeFor(100 + i));
+            tuple.add(start);
+            tuple.add(start + 86400UL);
+        } else {
+            JsonObject code = list.createNestedObject();
+            code["id"] = 100 + i;
+            code["pin"] = codeFor(100 + i);
+            code["start_unix"] = start;
+            code["end_unix"] = start + 86400UL;
+        }
+    }
+
+    std::vector<uint8_t> out(4096);
+    size_t length = format == JSON_OBJECTS
+        ? serializeJson(doc, (char*)out.data(), out.size())
+        : serializeMsgPack(doc, (char*)out.data(), out.size());
+    out.resize(length);
+    return out;
+}
+
+static uint16_t codesPerMessage(PageFormat format) {
+    uint16_t codes = 0;
+    while (encodePage(codes + 1, format).size() <= MQTT_PAYLOAD) codes++;
+    return codes;
+}
+
+// Parsed in place from a writable copy, as mqttCallback does with
+// PubSubClient's buffer
+static DeserializationError decode(JsonDocument& doc, std::vector<uint8_t> payload, PageFormat format) {
+    return format == JSON_OBJECTS
+        ? deserializeJson(doc, (char*)payload.data(), payload.size())
+        : deserializeMsgPack(doc, (char*)payload.data(), payload.size());
+}
+
+void setUp(void) {
+    LittleFS.format();
+    mockMillis = 0;
+    systemClock.sync(NOW);
+    manager = new AccessManager();
+}
+
+void tearDown(void) {
+    delete manager;
+}
+
+void test_page_sizes(void) {
+    size_t json = encodePage(8, JSON_OBJECTS).size();
+    size_t msgPackObjects = encodePage(8, MSGPACK_OBJECTS).size();
+    size_t msgPackTuples = encodePage(8, MSGPACK_TUPLES).size();
+    size_t header = encodePage(0, MSGPACK_TUPLES).size();
+
+    char line[160];
+    snprintf(line, sizeof(line), "8-code page: JSON %u B, MessagePack objects %u B, MessagePack tuples %u B",
+             (unsigned)json, (unsigned)msgPackObjects, (unsigned)msgPackTuples);
+    TEST_MESSAGE(line);
+    snprintf(line, sizeof(line), "per code: JSON %u B, MessagePack tuples %u B",
+             (unsigned)((json - encodePage(0, JSON_OBJECTS).size()) / 8), (unsigned)((msgPackTuples - header) / 8));
+    TEST_MESSAGE(line);
+    snprintf(line, sizeof(line), "codes per %u-byte message: JSON %u, MessagePack objects %u, MessagePack tuples %u",
+             (unsigned)MQTT_PAYLOAD, codesPerMessage(JSON_OBJECTS), codesPerMessage(MSGPACK_OBJECTS),
+             codesPerMessage(MSGPACK_TUPLES));
+    TEST_MESSAGE(line);
+
+    TEST_ASSERT_TRUE(msgPackTuples < msgPackObjects);
+    TEST_ASSERT_TRUE(msgPackObjects < json);
+}
+
+void test_every_format_stages_the_same_table(void) {
+    const PageFormat formats[] = {JSON_OBJECTS, MSGPACK_OBJECTS, MSGPACK_TUPLES};
+    for (PageFormat format : formats) {
+        uint16_t codes = codesPerMessage(format);
+        StaticJsonDocument<2048> doc;
+        TEST_ASSERT_FALSE(decode(doc, encodePage(codes, format), format));
+
+        AccessManager::StageResult result = manager->stageSyncPage(
+            doc["batch"].as<const char*>(), doc["part"] | 0, doc["parts"] | 0, doc["seq"] | 0UL,
+            doc["access_codes"].as<JsonArray>());
+        TEST_ASSERT_EQUAL(AccessManager::STAGE_COMMITTED, result);
+        TEST_ASSERT_EQUAL(codes, manager->getPinCount());
+        TEST_ASSERT_EQUAL_UINT32(42, manager->getSyncSeq());
+        TEST_ASSERT_TRUE(manager->validate(codeFor(100)));
+        TEST_ASSERT_FALSE(manager->validate(codeFor(101)));   // window starts in an hour
+    }
+}
+
+void test_benchmark_parse(void) {
+    static const uint32_t ROUNDS = 20000;
+    const PageFormat formats[] = {JSON_OBJECTS, MSGPACK_TUPLES};
+    const char* names[] = {"JSON", "MessagePack tuples"};
+    StaticJsonDocument<2048> doc;
+    for (int f = 0; f < 2; f++) {
+        std::vector<uint8_t> page = encodePage(8, formats[f]);
+        unsigned long started = micros();
+        for (uint32_t round = 0; round < ROUNDS; round++) {
+            decode(doc, page, formats[f]);
+        }
+        double perPage = (double)(micros() - started) / ROUNDS;
+
+        char line[128];
+        snprintf(line, sizeof(line), "parse 8-code page, %s: %.2f us", names[f], perPage);
+        TEST_MESSAGE(line);
+    }
+}
+
+// Decode plus applyDelta (table update and log append), as
+// handleAccessCodeDelta does for each message
+void test_benchmark_delta_rate(void) {
+    static const uint32_t DELTAS = 5000;
+    std::vector<std::vector<uint8_t>> messages;
+    for (uint32_t seq = 1; seq <= DELTAS; seq++) {
+        DynamicJsonDocument delta(512);
+        delta["action"] = "access_code_delta";
+        delta["seq"] = seq;
+        delta["id"] = seq % AccessManager::MAX_PINS;
+        delta["op"] = seq % 5 == 0 ? "delete" : "update";
+        delta["pin"] = codeFor(seq);
+        delta["start_unix"] = NOW - 60;
+        delta["end_unix"] = NOW + 3600;
+        std::vector<uint8_t> out(512);
+        out.resize(serializeJson(delta, (char*)out.data(), out.size()));
+        messages.push_back(out);
+    }
+
+    StaticJsonDocument<2048> doc;
+    uint32_t applied = 0;
+    unsigned long started = micros();
+    for (const std::vector<uint8_t>& message : messages) {
+        decode(doc, message, JSON_OBJECTS);
+        if (manager->applyDelta(doc.as<JsonObject>()) == AccessManager::DELTA_APPLIED) applied++;
+    }
+    unsigned long elapsed = micros() - started;
+    TEST_ASSERT_EQUAL_UINT32(DELTAS, applied);
+    TEST_ASSERT_EQUAL_UINT32(DELTAS, manager->getSyncSeq());
+
+    char line[128];
+    snprintf(line, sizeof(line), "JSON deltas: %.0f per second (%.2f us each)",
+             DELTAS * 1e6 / elapsed, (double)elapsed / DELTAS);
+    TEST_MESSAGE(line);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_page_sizes);
+    RUN_TEST(test_every_format_stages_the_same_table);
+    RUN_TEST(test_benchmark_parse);
+    RUN_TEST(test_benchmark_delta_rate);
+    return UNITY_END();
+}
@@ -0,0 +1,162 @@
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <unity.h>
+#include "globals.h"
+#include "EventJournal/EventJournal.h"
+
+// Referenced by the other modules linked into the native build
+DeviceConfig deviceConfig;
+SystemClock systemClock;
+
+static EventJournal* journal;
+
+static void appendEvents(uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        journal->append("1234", i % 2 == 0, 1767225600UL + i);
+    }
+}
+
+// Power cycle: RAM is lost, the file and its read position survive
+static void reboot() {
+    delete journal;
+    journal = new EventJournal();
+    journal->begin();
+}
+
+static size_t logSize() {
+    return LittleFS.exists("/events.log") ? LittleFS.files["/events.log"].size() : 0;
+}
+
+void setUp(void) {
+    LittleFS.format();
+    journal = new EventJournal();
+    journal->begin();
+}
+
+void tearDown(void) {
+    delete journal;
+}
+
+void test_drains_in_order_across_spills(void) {
+    appendEvents(40);
+    TEST_ASSERT_TRUE(LittleFS.exists("/events.log"));
+
+    uint32_t expected = 1;
+    AccessEvent batch[4];
+    while (uint8_t count = journal->peek(batch, 4)) {
+        for (uint8_t i = 0; i < count; i++) {
+            TEST_ASSERT_EQUAL_UINT32(expected++, batch[i].seq);
+        }
+        journal->consume(count);
+    }
+    TEST_ASSERT_EQUAL_UINT32(41, expected);
+    TEST_ASSERT_TRUE(journal->isEmpty());
+    TEST_ASSERT_FALSE(LittleFS.exists("/events.log"));
+    TEST_ASSERT_FALSE(LittleFS.exists("/events.pos"));
+}
+
+// A batch peeked from RAM is spilled to the file while its publish is in
+// flight; consuming it must drop those events, not the newer RAM head
+void test_consume_after_spill_drops_the_peeked_batch(void) {
+    appendEvents(4);
+    AccessEvent batch[4];
+    TEST_ASSERT_EQUAL(4, journal->peek(batch, 4));
+    TEST_ASSERT_EQUAL_UINT32(1, batch[0].seq);
+
+    appendEvents(16);   // the 17th event spills 1..16 to the file
+    TEST_ASSERT_EQUAL(20, journal->getPendingCount());
+    journal->consume(4);
+    TEST_ASSERT_EQUAL(16, journal->getPendingCount());
+
+    uint32_t expected = 5;
+    while (uint8_t count = journal->peek(batch, 4)) {
+        for (uint8_t i = 0; i < count; i++) {
+            TEST_ASSERT_EQUAL_UINT32(expected++, batch[i].seq);
+        }
+        journal->consume(count);
+    }
+    TEST_ASSERT_EQUAL_UINT32(21, expected);
+}
+
+void test_consume_without_a_peek_drops_nothing(void) {
+    appendEvents(8);
+    AccessEvent batch[4];
+    journal->peek(batch, 4);
+    journal->consume(4);
+    journal->consume(4);   // repeated completion of the same publish
+    TEST_ASSERT_EQUAL(4, journal->getPendingCount());
+    TEST_ASSERT_EQUAL(4, journal->peek(batch, 4));
+    TEST_ASSERT_EQUAL_UINT32(5, batch[0].seq);
+}
+
+void test_consume_after_the_file_was_discarded_drops_nothing(void) {
+    appendEvents(20);   // 1..16 in the file, 17..20 in RAM
+    AccessEvent batch[4];
+    TEST_ASSERT_EQUAL(4, journal->peek(batch, 4));
+    LittleFS.files["/events.log"].resize(10);   // torn while the batch was in flight
+
+    journal->consume(4);
+    TEST_ASSERT_EQUAL(20, journal->getPendingCount());
+    // The next peek discards the unreadable file; RAM is untouched
+    TEST_ASSERT_EQUAL(4, journal->peek(batch, 4));
+    TEST_ASSERT_EQUAL_UINT32(17, batch[0].seq);
+}
+
+void test_reboot_resumes_after_the_consumed_records(void) {
+    appendEvents(40);   // 1..32 spilled, 33..40 in RAM
+    AccessEvent batch[4];
+    for (int i = 0; i < 3; i++) {
+        journal->consume(journal->peek(batch, 4));
+    }
+
+    reboot();
+    TEST_ASSERT_EQUAL(20, journal->getPendingCount());
+    TEST_ASSERT_EQUAL(4, journal->peek(batch, 4));
+    TEST_ASSERT_EQUAL_UINT32(13, batch[0].seq);
+}
+
+void test_unusable_position_resends_the_whole_file(void) {
+    appendEvents(20);
+    AccessEvent batch[4];
+    journal->consume(journal->peek(batch, 4));
+    LittleFS.files["/events.pos"] = {5, 0, 0, 0};   // not on a record boundary
+
+    reboot();
+    TEST_ASSERT_EQUAL(16, journal->getPendingCount());
+    journal->peek(batch, 4);
+    TEST_ASSERT_EQUAL_UINT32(1, batch[0].seq);
+}
+
+void test_file_stays_within_capacity(void) {
+    const size_t limit = EventJournal::FILE_CAPACITY * sizeof(AccessEvent);
+    appendEvents(EventJournal::FILE_CAPACITY + 500);
+    TEST_ASSERT_TRUE(logSize() <= limit);
+    TEST_ASSERT_TRUE(journal->getDroppedCount() > 0);
+
+    // Consumed records still occupy the head of the file until it drains
+    AccessEvent batch[4];
+    for (int i = 0; i < 250; i++) {
+        journal->consume(journal->peek(batch, 4));
+    }
+    appendEvents(500);
+    TEST_ASSERT_TRUE(logSize() <= limit);
+
+    while (uint8_t count = journal->peek(batch, 4)) {
+        journal->consume(count);
+    }
+    TEST_ASSERT_EQUAL(0, logSize());
+    appendEvents(EventJournal::FILE_CAPACITY);
+    TEST_ASSERT_TRUE(logSize() <= limit);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_drains_in_order_across_spills);
+    RUN_TEST(test_consume_after_spill_drops_the_peeked_batch);
+    RUN_TEST(test_consume_without_a_peek_drops_nothing);
+    RUN_TEST(test_consume_after_the_file_was_discarded_drops_nothing);
+    RUN_TEST(test_reboot_resumes_after_the_consumed_records);
+    RUN_TEST(test_unusable_position_resends_the_whole_file);
+    RUN_TEST(test_file_stays_within_capacity);
+    return UNITY_END();
+}
@@ -0,0 +1,217 @@
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <unity.h>
+#include <new>
+#include <vector>
+#include "globals.h"
+#include "InboundParser/InboundParser.h"
+
+// Referenced by the other modules linked into the native build
+DeviceConfig deviceConfig;
+SystemClock systemClock;
+
+// Every heap allocation in the test binary is counted, so a parse that
+// allocates shows up whatever the allocator
+static size_t allocations = 0;
+
+void* operator new(size_t size) {
+    allocations++;
+    void* block = malloc(size ? size : 1);
+    if (!block) throw std::bad_alloc();
+    return block;
+}
+void* operator new[](size_t size) { return operator new(size); }
+void operator delete(void* block) noexcept { free(block); }
+void operator delete[](void* block) noexcept { free(block); }
+void operator delete(void* block, size_t) noexcept { free(block); }
+void operator delete[](void* block, size_t) noexcept { free(block); }
+
+static const char PREFIX[] = "device/c0ffee/";
+static const size_t PREFIX_LENGTH = sizeof(PREFIX) - 1;
+static const size_t MQTT_BUFFER = 512;   // Sync's PubSubClient buffer
+
+// Sync's inbound document; static like the member, so the test itself does
+// not allocate it per message
+static StaticJsonDocument<2048> doc;
+
+static std::vector<uint8_t> commandPayload(bool msgPack) {
+    DynamicJsonDocument command(512);
+    command["action"] = "pulse";
+    command["command_id"] = "c-7f3a9e1d-4b2c";
+    command["timestamp"] = 1767225600UL;
+    command["timestamp_ms"] = 1767225600123ULL;
+    std::vector<uint8_t> out(MQTT_BUFFER);
+    out.resize(msgPack ? serializeMsgPack(command, (char*)out.data(), out.size())
+                       : serializeJson(command, (char*)out.data(), out.size()));
+    return out;
+}
+
+// A full sync page as the backend sends it, with a key the device does not
+// use; MessagePack pages carry [id, pin, start_unix, end_unix] tuples
+static std::vector<uint8_t> pagePayload(bool msgPack, uint8_t codes) {
+    DynamicJsonDocument page(4096);
+    page["action"] = "sync_access_codes";
+    page["command_id"] = "c-000001";
+    page["batch"] = "b-1";
+    page["part"] = 1;
+    page["parts"] = 3;
+    page["seq"] = 42;
+    page["note"] = "ui-only";
+    JsonArray list = page.createNestedArray("access_codes");
+    for (uint8_t i = 0; i < codes; i++) {
+        char pin[8];
+        snprintf(pin, sizeof(pin), "%07u", 1000000u + i);
+        if (msgPack) {
+            JsonArray tuple = list.createNestedArray();
+            tuple.add(100 + i);
+            tuple.add(pin);
+            tuple.add(1767225600UL);
+            tuple.add(1767312000UL);
+        } else {
+            JsonObject code = list.createNestedObject();
+            code["id"] = 100 + i;
+            code["pin"] = pin;
+            code["start_unix"] = 1767225600UL;
+            code["end_unix"] = 1767312000UL;
+            code["label"] = "Guest";
+        }
+    }
+    std::vector<uint8_t> out(MQTT_BUFFER * 2);
+    out.resize(msgPack ? serializeMsgPack(page, (char*)out.data(), out.size())
+                       : serializeJson(page, (char*)out.data(), out.size()));
+    return out;
+}
+
+// Copies the payload into a fixed receive buffer, as PubSubClient hands it
+// over, and parses it there; returns the heap allocations the parse made
+static size_t parseReceived(const std::vector<uint8_t>& payload, InboundParser::Route route, uint8_t* buffer) {
+    memcpy(buffer, payload.data(), payload.size());
+    size_t before = allocations;
+    DeserializationError error = InboundParser::parse(doc, route, InboundParser::isMsgPack(buffer, payload.size()),
+                                                      buffer, payload.size());
+    size_t made = allocations - before;
+    TEST_ASSERT_FALSE(error);
+    return made;
+}
+
+void setUp(void) {
+    doc.clear();
+}
+
+void tearDown(void) {
+}
+
+void test_topics_are_routed_by_suffix(void) {
+    TEST_ASSERT_EQUAL(InboundParser::ROUTE_COMMAND, InboundParser::route("device/c0ffee/command", PREFIX, PREFIX_LENGTH));
+    TEST_ASSERT_EQUAL(InboundParser::ROUTE_ACCESS_CODES,
+                      InboundParser::route("device/c0ffee/access-codes/sync", PREFIX, PREFIX_LENGTH));
+    TEST_ASSERT_EQUAL(InboundParser::ROUTE_ECHO, InboundParser::route("device/c0ffee/echo", PREFIX, PREFIX_LENGTH));
+    TEST_ASSERT_EQUAL(InboundParser::ROUTE_IGNORED, InboundParser::route("device/beef00/command", PREFIX, PREFIX_LENGTH));
+    TEST_ASSERT_EQUAL(InboundParser::ROUTE_IGNORED, InboundParser::route("device/c0ffee/commands", PREFIX, PREFIX_LENGTH));
+    TEST_ASSERT_EQUAL(InboundParser::ROUTE_IGNORED, InboundParser::route("device/c0ffee/ack", PREFIX, PREFIX_LENGTH));
+}
+
+void test_encoding_is_recognized_by_first_byte(void) {
+    TEST_ASSERT_TRUE(InboundParser::isMsgPack(commandPayload(true).data(), commandPayload(true).size()));
+    TEST_ASSERT_FALSE(InboundParser::isMsgPack(commandPayload(false).data(), commandPayload(false).size()));
+    const uint8_t map16[] = {0xDE, 0x00, 0x10};
+    TEST_ASSERT_TRUE(InboundParser::isMsgPack(map16, sizeof(map16)));
+    TEST_ASSERT_FALSE(InboundParser::isMsgPack(map16, 0));
+}
+
+// Strings stay in the receive buffer: the document only points at them
+void test_command_is_parsed_in_place(void) {
+    const bool encodings[] = {false, true};
+    for (bool msgPack : encodings) {
+        std::vector<uint8_t> payload = commandPayload(msgPack);
+        uint8_t buffer[MQTT_BUFFER];
+        TEST_ASSERT_EQUAL(0, parseReceived(payload, InboundParser::ROUTE_COMMAND, buffer));
+
+        const char* action = doc["action"];
+        const char* commandId = doc["command_id"];
+        TEST_ASSERT_EQUAL_STRING("pulse", action);
+        TEST_ASSERT_EQUAL_STRING("c-7f3a9e1d-4b2c", commandId);
+        TEST_ASSERT_TRUE((const uint8_t*)commandId >= buffer && (const uint8_t*)commandId < buffer + payload.size());
+        TEST_ASSERT_EQUAL_UINT32(1767225600UL, doc["timestamp"] | 0UL);
+    }
+}
+
+void test_page_filter_keeps_only_known_keys(void) {
+    const bool encodings[] = {false, true};
+    for (bool msgPack : encodings) {
+        std::vector<uint8_t> payload = pagePayload(msgPack, 4);
+        TEST_ASSERT_TRUE(payload.size() <= MQTT_BUFFER);
+        uint8_t buffer[MQTT_BUFFER];
+        TEST_ASSERT_EQUAL(0, parseReceived(payload, InboundParser::ROUTE_ACCESS_CODES, buffer));
+
+        TEST_ASSERT_FALSE(doc.containsKey("note"));
+        TEST_ASSERT_EQUAL_STRING("b-1", doc["batch"]);
+        JsonArray codes = doc["access_codes"];
+        TEST_ASSERT_EQUAL(4, codes.size());
+        if (msgPack) {
+            TEST_ASSERT_EQUAL_STRING("1000003", codes[3][1]);
+        } else {
+            TEST_ASSERT_EQUAL_STRING("1000003", codes[3]["pin"]);
+            TEST_ASSERT_FALSE(codes[3].containsKey("label"));
+        }
+    }
+}
+
+void test_malformed_payload_is_an_error(void) {
+    uint8_t truncated[] = "{\"action\":\"pul";
+    TEST_ASSERT_TRUE(InboundParser::parse(doc, InboundParser::ROUTE_COMMAND, false, truncated, sizeof(truncated) - 1));
+    uint8_t empty[1] = {0};
+    TEST_ASSERT_TRUE(InboundParser::parse(doc, InboundParser::ROUTE_COMMAND, false, empty, 0));
+}
+
+// Receive copy plus route, encoding check and parse, per message
+void test_benchmark_messages_per_second(void) {
+    static const uint32_t ROUNDS = 20000;
+    static const char* TOPICS[] = {"device/c0ffee/command", "device/c0ffee/access-codes/sync"};
+    struct Case {
+        const char* name;
+        std::vector<uint8_t> payload;
+        uint8_t topic;
+    } cases[] = {
+        {"command, JSON", commandPayload(false), 0},
+        {"command, MessagePack", commandPayload(true), 0},
+        {"4-code page, JSON", pagePayload(false, 4), 1},
+        {"4-code page, MessagePack tuples", pagePayload(true, 4), 1},
+    };
+
+    uint8_t buffer[MQTT_BUFFER];
+    for (const Case& c : cases) {
+        TEST_ASSERT_TRUE(c.payload.size() <= MQTT_BUFFER);
+        size_t allocationsBefore = allocations;
+        unsigned long started = micros();
+        for (uint32_t round = 0; round < ROUNDS; round++) {
+            memcpy(buffer, c.payload.data(), c.payload.size());
+            InboundParser::Route route = InboundParser::route(TOPICS[c.topic], PREFIX, PREFIX_LENGTH);
+            bool msgPack = InboundParser::isMsgPack(buffer, c.payload.size());
+            if (InboundParser::parse(doc, route, msgPack, buffer, c.payload.size())) {
+                TEST_FAIL_MESSAGE(c.name);
+            }
+        }
+        unsigned long elapsed = micros() - started;
+        double perSecond = ROUNDS * 1e6 / (elapsed > 0 ? elapsed : 1);
+
+        char line[128];
+        snprintf(line, sizeof(line), "%s (%u B): %.0f messages/s, %.2f us each", c.name, (unsigned)c.payload.size(),
+                 perSecond, (double)elapsed / ROUNDS);
+        TEST_MESSAGE(line);
+        TEST_ASSERT_EQUAL(0, allocations - allocationsBefore);
+        // Far below what the host does; catches an accidental slow path
+        TEST_ASSERT_TRUE(perSecond > 20000);
+    }
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_topics_are_routed_by_suffix);
+    RUN_TEST(test_encoding_is_recognized_by_first_byte);
+    RUN_TEST(test_command_is_parsed_in_place);
+    RUN_TEST(test_page_filter_keeps_only_known_keys);
+    RUN_TEST(test_malformed_payload_is_an_error);
+    RUN_TEST(test_benchmark_messages_per_second);
+    return UNITY_END();
+}
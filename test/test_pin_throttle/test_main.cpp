@@ -0,0 +1,170 @@
+#include <Arduino.h>
+#include <unity.h>
+#include "globals.h"
+#include "PinThrottle/PinThrottle.h"
+
+// Referenced by the other modules linked into the native build
+DeviceConfig deviceConfig;
+SystemClock systemClock;
+
+// Mirrors the limits in PinThrottle.h
+static const unsigned long REFILL_MS = 3000;
+static const unsigned long BASE_LOCKOUT_MS = 30000;
+static const unsigned long MAX_LOCKOUT_MS = 15UL * 60000UL;
+static const uint32_t CLIENT = 0x0A00000A;   // 10.0.0.10
+
+static PinThrottle* throttle;
+
+// A wrong PIN as the web server handles it: only tried if a token is free
+static unsigned long failAttempt(uint32_t ip) {
+    unsigned long retry = throttle->acquire(ip);
+    if (retry == 0) throttle->recordFailure(ip);
+    return retry;
+}
+
+// Five wrong PINs, spaced so the bucket never runs dry; the clock stops at
+// the one that locks
+static void failUntilLocked(uint32_t ip) {
+    for (uint8_t i = 0; i < 5; i++) {
+        if (i > 0) mockMillis += REFILL_MS;
+        TEST_ASSERT_EQUAL(0, failAttempt(ip));
+    }
+}
+
+void setUp(void) {
+    mockMillis = 100000;
+    throttle = new PinThrottle();
+}
+
+void tearDown(void) {
+    delete throttle;
+}
+
+void test_bucket_allows_a_burst_then_one_per_refill(void) {
+    for (uint8_t i = 0; i < 3; i++) {
+        TEST_ASSERT_EQUAL(0, throttle->acquire(CLIENT));
+    }
+    TEST_ASSERT_EQUAL(REFILL_MS, throttle->acquire(CLIENT));
+    mockMillis += 1000;
+    TEST_ASSERT_EQUAL(REFILL_MS - 1000, throttle->acquire(CLIENT));
+    TEST_ASSERT_EQUAL(2, throttle->getRejectedCount());
+
+    mockMillis += REFILL_MS - 1000;
+    TEST_ASSERT_EQUAL(0, throttle->acquire(CLIENT));
+    TEST_ASSERT_TRUE(throttle->acquire(CLIENT) > 0);
+
+    // A long pause refills the bucket, but never beyond three attempts
+    mockMillis += 10 * REFILL_MS;
+    for (uint8_t i = 0; i < 3; i++) {
+        TEST_ASSERT_EQUAL(0, throttle->acquire(CLIENT));
+    }
+    TEST_ASSERT_TRUE(throttle->acquire(CLIENT) > 0);
+    TEST_ASSERT_EQUAL(0, throttle->getLockoutCount());
+}
+
+void test_fifth_failure_locks_out(void) {
+    for (uint8_t i = 0; i < 4; i++) {
+        TEST_ASSERT_EQUAL(0, failAttempt(CLIENT));
+        mockMillis += REFILL_MS;
+    }
+    TEST_ASSERT_EQUAL(0, throttle->getActiveLockouts());
+    TEST_ASSERT_EQUAL(0, failAttempt(CLIENT));
+    TEST_ASSERT_EQUAL(1, throttle->getLockoutCount());
+    TEST_ASSERT_EQUAL(1, throttle->getActiveLockouts());
+
+    // Locked even with tokens to spare, until the 30 s are over
+    unsigned long retry = throttle->acquire(CLIENT);
+    TEST_ASSERT_TRUE(retry >= BASE_LOCKOUT_MS && retry <= BASE_LOCKOUT_MS + 1);
+    mockMillis += retry - 1;
+    TEST_ASSERT_EQUAL(1, throttle->acquire(CLIENT));
+    mockMillis += 1;
+    TEST_ASSERT_EQUAL(0, throttle->acquire(CLIENT));
+    TEST_ASSERT_EQUAL(0, throttle->getActiveLockouts());
+}
+
+void test_success_clears_failures(void) {
+    for (uint8_t i = 0; i < 4; i++) {
+        failAttempt(CLIENT);
+        mockMillis += REFILL_MS;
+    }
+    throttle->recordSuccess(CLIENT);
+    for (uint8_t i = 0; i < 4; i++) {
+        failAttempt(CLIENT);
+        mockMillis += REFILL_MS;
+    }
+    TEST_ASSERT_EQUAL(0, throttle->getLockoutCount());
+}
+
+void test_lockout_doubles_up_to_fifteen_minutes(void) {
+    const unsigned long expected[] = {30000, 60000, 120000, 240000, 480000, MAX_LOCKOUT_MS, MAX_LOCKOUT_MS};
+    for (unsigned long duration : expected) {
+        failUntilLocked(CLIENT);
+        unsigned long retry = throttle->acquire(CLIENT);
+        TEST_ASSERT_TRUE(retry >= duration && retry <= duration + 1);
+        mockMillis += retry;
+    }
+    TEST_ASSERT_EQUAL(7, throttle->getLockoutCount());
+
+    // A correct PIN starts the next round at 30 s again
+    throttle->recordSuccess(CLIENT);
+    failUntilLocked(CLIENT);
+    TEST_ASSERT_TRUE(throttle->acquire(CLIENT) <= BASE_LOCKOUT_MS + 1);
+}
+
+void test_penalty_forgotten_after_an_hour_quiet(void) {
+    failUntilLocked(CLIENT);
+    mockMillis += BASE_LOCKOUT_MS + 1;
+    failUntilLocked(CLIENT);
+    mockMillis += 2 * BASE_LOCKOUT_MS + 1;
+    TEST_ASSERT_EQUAL(0, throttle->acquire(CLIENT));
+
+    mockMillis += 60UL * 60000UL + 1;
+    failUntilLocked(CLIENT);
+    unsigned long retry = throttle->acquire(CLIENT);
+    TEST_ASSERT_TRUE(retry >= BASE_LOCKOUT_MS && retry <= BASE_LOCKOUT_MS + 1);
+}
+
+void test_new_client_reuses_the_least_recently_seen_slot(void) {
+    // Client 1 is locked out; clients 2..8 fill the other slots, each one
+    // failure short of a lockout
+    failUntilLocked(1);
+    for (uint32_t ip = 2; ip <= 8; ip++) {
+        mockMillis += 1000;
+        for (uint8_t i = 0; i < 4; i++) throttle->recordFailure(ip);
+    }
+    mockMillis += 1000;
+    throttle->acquire(2);
+
+    // Client 9 takes the slot of 3, the least recently seen unlocked one
+    TEST_ASSERT_EQUAL(0, throttle->acquire(9));
+    TEST_ASSERT_TRUE(throttle->acquire(1) > 0);   // the lockout survives
+    throttle->recordFailure(2);                   // 2 kept its count
+    TEST_ASSERT_EQUAL(2, throttle->getLockoutCount());
+    throttle->recordFailure(3);                   // 3 starts over
+    TEST_ASSERT_EQUAL(2, throttle->getLockoutCount());
+}
+
+void test_all_slots_locked_recycles_the_oldest(void) {
+    for (uint32_t ip = 1; ip <= 8; ip++) {
+        for (uint8_t i = 0; i < 5; i++) throttle->recordFailure(ip);
+        mockMillis += 1000;
+    }
+    TEST_ASSERT_EQUAL(8, throttle->getActiveLockouts());
+
+    // A ninth client is still served; the earliest lockout gives way
+    TEST_ASSERT_EQUAL(0, throttle->acquire(9));
+    TEST_ASSERT_EQUAL(7, throttle->getActiveLockouts());
+    TEST_ASSERT_TRUE(throttle->acquire(8) > 0);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_bucket_allows_a_burst_then_one_per_refill);
+    RUN_TEST(test_fifth_failure_locks_out);
+    RUN_TEST(test_success_clears_failures);
+    RUN_TEST(test_lockout_doubles_up_to_fifteen_minutes);
+    RUN_TEST(test_penalty_forgotten_after_an_hour_quiet);
+    RUN_TEST(test_new_client_reuses_the_least_recently_seen_slot);
+    RUN_TEST(test_all_slots_locked_recycles_the_oldest);
+    return UNITY_END();
+}
@@ -0,0 +1,198 @@
+#include <Arduino.h>
+#include <unity.h>
+#include <string>
+#include <vector>
+#include "globals.h"
+#include "Relay/Relay.h"
+
+// Referenced by the other modules linked into the native build
+DeviceConfig deviceConfig;
+SystemClock systemClock;
+
+struct Ack {
+    std::string action;
+    std::string commandId;
+    Relay::Trace trace;
+};
+
+static Relay* driver;
+static std::vector<std::string> edges;   // "on:<action>" / "off:<action>"
+static std::vector<Ack> acks;
+
+static void recordEdge(const char* state, const char* action, bool remote) {
+    edges.push_back(std::string(state) + ":" + action);
+}
+
+static void recordAck(const char* action, const char* commandId, const Relay::Trace* trace) {
+    acks.push_back({action, commandId, *trace});
+}
+
+static Relay::Trace traceAt(uint32_t arrived) {
+    Relay::Trace trace = {};
+    trace.arrived = arrived;
+    trace.parsed = arrived + 1;
+    trace.transitMs = Relay::TRANSIT_UNKNOWN;
+    return trace;
+}
+
+// Steps the mocked clock a millisecond at a time, running loop() on each
+static void runFor(unsigned long ms) {
+    for (unsigned long i = 0; i < ms; i++) {
+        mockMillis++;
+        driver->loop();
+    }
+}
+
+void setUp(void) {
+    deviceConfig.initDefaultConfig();   // 500 ms pulses
+    mockMillis = 1000;
+    edges.clear();
+    acks.clear();
+    driver = new Relay();
+    driver->init(recordEdge, recordAck);
+}
+
+void tearDown(void) {
+    delete driver;
+}
+
+void test_pulse_lasts_the_configured_width(void) {
+    TEST_ASSERT_EQUAL(Relay::QUEUED, driver->request("pulse", nullptr));
+    TEST_ASSERT_FALSE(driver->isActive());
+
+    driver->loop();
+    TEST_ASSERT_EQUAL(1, edges.size());
+    TEST_ASSERT_EQUAL_STRING("on:pulse", edges[0].c_str());
+
+    runFor(deviceConfig.getPulseWidth() - 1);
+    TEST_ASSERT_EQUAL(1, edges.size());
+    runFor(1);
+    TEST_ASSERT_EQUAL(2, edges.size());
+    TEST_ASSERT_EQUAL_STRING("off:pulse", edges[1].c_str());
+    TEST_ASSERT_EQUAL(1, driver->getPulseCount());
+
+    // The off gap keeps it busy for another 500 ms, then it goes idle
+    TEST_ASSERT_TRUE(driver->isActive());
+    runFor(500);
+    TEST_ASSERT_FALSE(driver->isActive());
+    TEST_ASSERT_EQUAL(0, acks.size());   // local requests are never acked
+}
+
+void test_repeat_during_pulse_is_coalesced(void) {
+    Relay::Trace first = traceAt(100);
+    Relay::Trace second = traceAt(200);
+    driver->request("open", "cmd-1", &first);
+    driver->loop();
+    runFor(100);
+
+    TEST_ASSERT_EQUAL(Relay::COALESCED, driver->request("open", "cmd-2", &second));
+    TEST_ASSERT_EQUAL(1, driver->getCoalescedCount());
+    runFor(deviceConfig.getPulseWidth() + 500);
+
+    // One pulse, both commands acked by its off edge
+    TEST_ASSERT_EQUAL(2, edges.size());
+    TEST_ASSERT_EQUAL(1, driver->getPulseCount());
+    TEST_ASSERT_EQUAL(2, acks.size());
+    TEST_ASSERT_EQUAL_STRING("cmd-1", acks[0].commandId.c_str());
+    TEST_ASSERT_EQUAL_STRING("cmd-2", acks[1].commandId.c_str());
+    // The repeat found the relay on: no dispatch delay of its own
+    TEST_ASSERT_EQUAL(second.parsed, acks[1].trace.relayOn);
+    TEST_ASSERT_EQUAL(acks[0].trace.relayOff, acks[1].trace.relayOff);
+    TEST_ASSERT_FALSE(driver->isActive());
+}
+
+void test_request_during_gap_gets_its_own_pulse(void) {
+    driver->request("pulse", nullptr);
+    driver->loop();
+    runFor(deviceConfig.getPulseWidth() + 100);   // off, 100 ms into the gap
+
+    TEST_ASSERT_EQUAL(Relay::QUEUED, driver->request("pulse", nullptr));
+    runFor(399);
+    TEST_ASSERT_EQUAL(2, edges.size());
+    runFor(2);   // gap over, then idle picks up the next request
+    TEST_ASSERT_EQUAL(3, edges.size());
+    TEST_ASSERT_EQUAL_STRING("on:pulse", edges[2].c_str());
+    runFor(deviceConfig.getPulseWidth() + 500);
+    TEST_ASSERT_EQUAL(2, driver->getPulseCount());
+    TEST_ASSERT_EQUAL(0, driver->getCoalescedCount());
+}
+
+void test_full_queue_rejects(void) {
+    for (uint8_t i = 0; i < 6; i++) {
+        TEST_ASSERT_EQUAL(Relay::QUEUED, driver->request("pulse", nullptr));
+    }
+    TEST_ASSERT_EQUAL(Relay::REJECTED, driver->request("pulse", "cmd-7"));
+
+    // A rejected command is never acked, and a repeat during the first pulse
+    // still has no room
+    driver->loop();
+    TEST_ASSERT_EQUAL(Relay::REJECTED, driver->request("pulse", "cmd-8"));
+
+    // Once the first pulse is done there is room again
+    runFor(deviceConfig.getPulseWidth());
+    TEST_ASSERT_EQUAL(Relay::QUEUED, driver->request("pulse", "cmd-9"));
+    runFor(10000);
+    TEST_ASSERT_EQUAL(7, driver->getPulseCount());
+    TEST_ASSERT_EQUAL(1, acks.size());
+    TEST_ASSERT_EQUAL_STRING("cmd-9", acks[0].commandId.c_str());
+}
+
+void test_ack_waits_for_the_off_edge(void) {
+    Relay::Trace trace = traceAt(50);
+    trace.transitMs = 12;
+    driver->request("open", "cmd-1", &trace);
+    driver->loop();
+
+    runFor(deviceConfig.getPulseWidth() - 1);
+    TEST_ASSERT_EQUAL(0, acks.size());
+    runFor(1);
+    TEST_ASSERT_EQUAL(1, acks.size());
+    TEST_ASSERT_EQUAL_STRING("open", acks[0].action.c_str());
+    TEST_ASSERT_EQUAL_STRING("cmd-1", acks[0].commandId.c_str());
+    TEST_ASSERT_EQUAL(50, acks[0].trace.arrived);
+    TEST_ASSERT_EQUAL(12, acks[0].trace.transitMs);
+    TEST_ASSERT_TRUE(acks[0].trace.relayOn != 0);
+    TEST_ASSERT_TRUE(acks[0].trace.relayOff >= acks[0].trace.relayOn);
+}
+
+// The relay used to be driven with digitalWrite() + delay(500), so loop()
+// stalled for the whole pulse width. Here every loop() runs at most one edge.
+void test_loop_never_blocks_during_a_pulse(void) {
+    const uint8_t pulses = 20;
+    unsigned long worst = 0;
+    for (uint8_t i = 0; i < pulses; i++) {
+        driver->request("pulse", nullptr);
+        unsigned long started = micros();
+        driver->loop();
+        unsigned long took = micros() - started;
+        if (took > worst) worst = took;
+        for (unsigned long ms = 0; ms < deviceConfig.getPulseWidth() + 500UL; ms++) {
+            mockMillis++;
+            started = micros();
+            driver->loop();
+            took = micros() - started;
+            if (took > worst) worst = took;
+        }
+    }
+    TEST_ASSERT_EQUAL(pulses, driver->getPulseCount());
+
+    char line[160];
+    snprintf(line, sizeof(line), "%u pulses of %u ms: longest loop() %lu us, longest gap between loops %lu us (was %lu us with delay())",
+             pulses, deviceConfig.getPulseWidth(), worst, driver->getMaxLoopGapMicros(),
+             (unsigned long)deviceConfig.getPulseWidth() * 1000UL);
+    TEST_MESSAGE(line);
+    // Host timings, generous for a busy CI machine: far below one pulse
+    TEST_ASSERT_TRUE(worst < 10000);
+    TEST_ASSERT_TRUE(driver->getMaxLoopGapMicros() < 50000);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_pulse_lasts_the_configured_width);
+    RUN_TEST(test_repeat_during_pulse_is_coalesced);
+    RUN_TEST(test_request_during_gap_gets_its_own_pulse);
+    RUN_TEST(test_full_queue_rejects);
+    RUN_TEST(test_ack_waits_for_the_off_edge);
+    RUN_TEST(test_loop_never_blocks_during_a_pulse);
+    return UNITY_END();
+}